@@ -0,0 +1,134 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+// measures how long the demuxer thread spends handing packets to viewers,
+// once with two fast viewers and once with one of them throttled. push
+// latency of the source should not depend on how fast viewers write
+
+#include "write/packet_queue.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <initializer_list>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr const size_t Queue_Size     = 256; // as viewers
+constexpr const size_t Packet_Count   = 20000;
+constexpr const size_t Gop_Size       = 50;
+constexpr const auto   Packet_Gap     = std::chrono::microseconds{250};
+constexpr const auto   Slow_Write     = std::chrono::milliseconds{2};
+constexpr const int    Packet_Payload = 1400;
+
+// a viewer which drops up to next key frame when its queue is full
+struct consumer {
+    lxstreamer::packet_queue  queue{Queue_Size};
+    std::chrono::microseconds write_time;
+    bool                      overflowed{false};
+    size_t                    dropped{0};
+    std::thread               worker;
+
+    explicit consumer(std::chrono::microseconds t) : write_time{t} {
+        worker = std::thread{[this] {
+            while (true) {
+                queue.wait();
+                if (!queue.drain([this](const AVPacket* pkt) {
+                        if (pkt->size == 0)
+                            return false; // end of test
+                        if (write_time.count() > 0)
+                            std::this_thread::sleep_for(write_time);
+                        return true;
+                    }))
+                    break;
+            }
+        }};
+    }
+
+    ~consumer() {
+        queue.stop();
+        worker.join();
+    }
+
+    void push(const AVPacket* pkt) {
+        if (overflowed) {
+            if (!(pkt->flags & AV_PKT_FLAG_KEY)) {
+                ++dropped;
+                return;
+            }
+            overflowed = false;
+        }
+        if (!queue.push(pkt)) {
+            overflowed = true;
+            ++dropped;
+        }
+    }
+};
+
+double
+percentile(std::vector<double>& values, double p) {
+    auto idx = static_cast<size_t>(p * (values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + idx, values.end());
+    return values[idx];
+}
+
+void
+run(const char* title, std::chrono::microseconds second_write) {
+    consumer fast{std::chrono::microseconds{0}};
+    consumer slow{second_write};
+
+    auto* pkt = av_packet_alloc();
+    av_new_packet(pkt, Packet_Payload);
+    std::vector<double> latencies; // us
+    latencies.reserve(Packet_Count);
+
+    auto next = clock_type::now();
+    for (size_t i = 0; i < Packet_Count; ++i) {
+        pkt->flags = i % Gop_Size == 0 ? AV_PKT_FLAG_KEY : 0;
+        auto start = clock_type::now();
+        fast.push(pkt);
+        slow.push(pkt);
+        std::chrono::duration<double, std::micro> spent =
+            clock_type::now() - start;
+        latencies.push_back(spent.count());
+        next += Packet_Gap;
+        std::this_thread::sleep_until(next);
+    }
+
+    // an empty packet ends consumers after their queued packets
+    auto* end = av_packet_alloc();
+    for (auto* c : {&fast, &slow})
+        while (!c->queue.push(end))
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+
+    std::printf(
+        "%s\n  push latency us: p50 %.2f  p99 %.2f  p99.9 %.2f  max %.2f\n"
+        "  fast viewer dropped: %zu  slow viewer dropped: %zu\n",
+        title,
+        percentile(latencies, 0.5),
+        percentile(latencies, 0.99),
+        percentile(latencies, 0.999),
+        *std::max_element(latencies.cbegin(), latencies.cend()),
+        fast.dropped,
+        slow.dropped);
+    av_packet_free(&end);
+    av_packet_free(&pkt);
+}
+
+} // namespace
+
+int
+main() {
+    run("two fast viewers", std::chrono::microseconds{0});
+    run("one fast and one throttled viewer", Slow_Write);
+    return 0;
+}
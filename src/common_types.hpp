@@ -9,7 +9,9 @@
 #ifndef COMMON_TYPES_HPP
 #define COMMON_TYPES_HPP
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace lxstreamer {
 
@@ -54,6 +56,21 @@ enum class file_format_t {
     unknown = -1,
 };
 
+enum class rate_control_t {
+    capped = 0, ///< average bitrate limited by max_bitrate
+    cbr    = 1, ///< constant bitrate of max_bitrate
+    crf    = 2, ///< constant quality of crf limited by max_bitrate
+};
+
+enum class scale_algorithm_t {
+    fast_bilinear = 0, ///< fastest, lowest quality
+    bilinear      = 1,
+    bicubic       = 2, ///< good quality for upscaling
+    area          = 3, ///< good quality for downscaling
+    point         = 4, ///< nearest neighbor
+    lanczos       = 5, ///< slowest, highest quality
+};
+
 struct encoding_t {
     codec_t codec{codec_t::unknown};
     // video only
@@ -61,6 +78,16 @@ struct encoding_t {
     int    height{0};
     size_t max_bitrate{0};
     int    frame_rate{-1};
+    // video encoder profile, defaults are tuned for live streaming
+    std::string    preset; ///< encoder preset, empty for a fast live preset
+    std::string    tune;   ///< encoder tune, empty for zerolatency if supported
+    rate_control_t rate_control{rate_control_t::capped};
+    int            crf{-1};       ///< quality for crf mode, -1 for default
+    int            gop{0};        ///< frames between key frames, 0 for 2 sec
+    int            b_frames{0};   ///< max consecutive b-frames
+    int            lookahead{-1}; ///< rate control lookahead frames, -1 for
+                                  ///< encoder default of live preset
+    int            threads{0};    ///< encoder threads, 0 for auto
     // audio only
     int         sample_rate{-1};
     std::string sample_fmt;
@@ -70,7 +97,11 @@ struct encoding_t {
         return codec == o.codec && codec == o.codec && width == o.width &&
                height == o.height && max_bitrate == o.max_bitrate &&
                frame_rate == o.frame_rate && sample_rate == o.sample_rate &&
-               sample_fmt == o.sample_fmt && channel_layout == o.channel_layout;
+               sample_fmt == o.sample_fmt &&
+               channel_layout == o.channel_layout && preset == o.preset &&
+               tune == o.tune && rate_control == o.rate_control &&
+               crf == o.crf && gop == o.gop && b_frames == o.b_frames &&
+               lookahead == o.lookahead && threads == o.threads;
     }
 };
 
@@ -100,6 +131,58 @@ struct source_args_t {
     container_t container{
         container_t::unknown}; ///< preferred container format, automatically
                                ///< chosen if not defined
+    size_t pre_record_duration{0}; ///< seconds of stream kept in memory to be
+                                   ///< prepended to recordings, 0 to disable
+    std::vector<int> cpus; ///< cpu cores which threads of the source run on,
+                           ///< empty for no pinning
+    int numa_node{-1}; ///< numa node which threads of the source run on if
+                       ///< cpus is empty, -1 for no pinning
+    size_t probe_size{0};       ///< max bytes read for finding stream info,
+                                ///< 0 for FFmpeg default
+    size_t analyze_duration{0}; ///< max ms of stream analyzed for finding
+                                ///< stream info, 0 for FFmpeg default
+    bool probe_cache{true}; ///< reuse stream info of network sources found
+                            ///< on last connection for a short probe
+    size_t timeout{20}; ///< seconds without receiving data from source after
+                        ///< which it's reconnected
+    size_t viewless_timeout{30}; ///< seconds without any viewer after which
+                                 ///< source stops demuxing
+    size_t standby_duration{0}; ///< seconds a source without viewers keeps
+                                ///< its connection paused for a fast start
+                                ///< before closing it, 0 to close at once
+    size_t encoder_pool_size{4}; ///< max encoders of the source kept open,
+                                 ///< least recently used idle ones are
+                                 ///< closed first
+    size_t encoder_idle_timeout{60}; ///< seconds an idle encoder is kept
+                                     ///< warm for next viewers
+    scale_algorithm_t scale_algorithm{
+        scale_algorithm_t::fast_bilinear}; ///< algorithm of video scaling
+    size_t scale_threads{0}; ///< slice threads of each video scaling, 0 for
+                             ///< one per cpu of source or 1 if not pinned
+    size_t thumbnail_interval{0}; ///< seconds between thumbnails made for
+                                  ///< snapshots, keeps source demuxing. 0
+                                  ///< to make them only when requested
+    int thumbnail_height{180}; ///< height of thumbnails, width keeps aspect
+
+    bool operator==(const source_args_t& o) const {
+        return name == o.name && url == o.url &&
+               auth_session == o.auth_session &&
+               video_encoding == o.video_encoding &&
+               audio_encoding == o.audio_encoding && container == o.container &&
+               pre_record_duration == o.pre_record_duration &&
+               cpus == o.cpus && numa_node == o.numa_node &&
+               probe_size == o.probe_size &&
+               analyze_duration == o.analyze_duration &&
+               probe_cache == o.probe_cache && timeout == o.timeout &&
+               viewless_timeout == o.viewless_timeout &&
+               standby_duration == o.standby_duration &&
+               encoder_pool_size == o.encoder_pool_size &&
+               encoder_idle_timeout == o.encoder_idle_timeout &&
+               scale_algorithm == o.scale_algorithm &&
+               scale_threads == o.scale_threads &&
+               thumbnail_interval == o.thumbnail_interval &&
+               thumbnail_height == o.thumbnail_height;
+    }
 };
 
 // options for source recording
@@ -114,6 +197,65 @@ struct record_options_t {
     size_t     file_duration{0};   ///< chunk file duration in sec
     size_t     write_interval{5};  ///< interval for writing to file in seconds
     bool       record_audio{true}; ///< if audio should be recorded
+    size_t     max_age{0};  ///< hours to keep recorded files, 0 to keep all
+    size_t     max_size{0}; ///< mega bytes of recorded files of the source to
+                            ///< keep by deleting oldest ones, 0 for no limit
+    bool recycle{false}; ///< delete oldest recorded files of the source when
+                         ///< disk is getting full instead of stopping
+
+    bool operator==(const record_options_t& o) const {
+        return path == o.path && format == o.format &&
+               video_encoding == o.video_encoding &&
+               audio_encoding == o.audio_encoding &&
+               file_size == o.file_size && file_duration == o.file_duration &&
+               write_interval == o.write_interval &&
+               record_audio == o.record_audio && max_age == o.max_age &&
+               max_size == o.max_size && recycle == o.recycle;
+    }
+};
+
+// declaration of a source for streamer::apply_sources
+struct source_config_t {
+    source_args_t    args;
+    bool             record{false};  ///< if source should be recorded
+    record_options_t record_options; ///< used if record is true
+};
+
+enum class source_state_t {
+    stopped    = 0, ///< not demuxing since it's not needed
+    connecting = 1, ///< opening and probing input
+    connected  = 2, ///< demuxing
+    waiting    = 3, ///< waiting to reconnect after a failure
+    standby    = 4, ///< connected but paused until a viewer comes
+};
+
+// health of a source connection
+struct source_status_t {
+    source_state_t state{source_state_t::stopped};
+    size_t         failures{0};       ///< consecutive failed connections
+    int64_t        connected_time{0}; ///< ms since epoch of last connection
+    int64_t        retry_time{0};     ///< ms since epoch of next connection
+                                      ///< attempt if it's waiting
+    int         last_error{0}; ///< error code of last disconnection
+    std::string last_error_message;
+    size_t      encoders{0};       ///< open encoders, including idle ones
+    size_t      encoder_opens{0};  ///< encoders opened
+    size_t      encoder_reuses{0}; ///< idle encoders reused by new viewers
+};
+
+// latest thumbnail of a source
+struct snapshot_t {
+    std::string image;   ///< jpeg image
+    int64_t     time{0}; ///< ms since epoch the image is made at
+};
+
+// a recorded file overlapping a requested time range
+struct record_segment_t {
+    std::string path;          ///< recorded file path
+    int64_t     offset{0};     ///< byte offset to start reading from, the
+                               ///< nearest key frame is at or after it
+    int64_t     start_time{0}; ///< file start time in ms since epoch
+    int64_t     end_time{0};   ///< file end time in ms since epoch
 };
 
 } // namespace lxstreamer
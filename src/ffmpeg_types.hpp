@@ -16,10 +16,12 @@ extern "C" {
 #include <libavfilter/buffersink.h>
 #include <libavfilter/buffersrc.h>
 #include <libavformat/avformat.h>
+#include <libavutil/audio_fifo.h>
 #include <libavutil/channel_layout.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/mathematics.h>
 #include <libavutil/timestamp.h>
+#include <libswresample/swresample.h>
 #include <libswscale/swscale.h>
 }
 
@@ -170,6 +172,10 @@ struct deleter {
         avcodec_free_context(&ctx);
     }
 
+    void operator()(AVCodecParameters* par) noexcept {
+        avcodec_parameters_free(&par);
+    }
+
     void operator()(AVFrame* fr, bool unref) noexcept {
         if (fr == nullptr)
             return;
@@ -188,6 +194,14 @@ struct deleter {
         sws_freeContext(ctx);
     }
 
+    void operator()(SwrContext* ctx) noexcept {
+        swr_free(&ctx);
+    }
+
+    void operator()(AVAudioFifo* fifo) noexcept {
+        av_audio_fifo_free(fifo);
+    }
+
     void operator()(AVDictionary* dic) noexcept {
         av_dict_free(&dic);
     }
@@ -0,0 +1,316 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#include "file_sender.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <unordered_map>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#endif
+
+namespace lxstreamer {
+
+namespace {
+
+// bytes written by sendfile per connection on each loop iteration, keeps
+// a fast client from starving others
+constexpr const int64_t Send_Budget = 4 * 1024 * 1024;
+
+enum class range_t { none, valid, unsatisfiable };
+
+// parses a single byte range of a file of <size> bytes, multiple ranges are
+// served as the whole file
+range_t
+parse_range(
+    const std::string& header, int64_t size, int64_t& first, int64_t& last) {
+    constexpr const char* unit = "bytes=";
+    if (header.rfind(unit, 0) != 0 || header.find(',') != std::string::npos)
+        return range_t::none;
+    auto spec = header.substr(std::strlen(unit));
+    auto dash = spec.find('-');
+    if (dash == std::string::npos)
+        return range_t::none;
+
+    auto to_int = [](const std::string& s, int64_t& v) {
+        if (s.empty() ||
+            s.find_first_not_of("0123456789") != std::string::npos)
+            return false;
+        v = std::strtoll(s.c_str(), nullptr, 10);
+        return true;
+    };
+    auto from = spec.substr(0, dash);
+    auto to   = spec.substr(dash + 1);
+    if (from.empty()) {
+        int64_t suffix = 0; // last <suffix> bytes
+        if (!to_int(to, suffix))
+            return range_t::none;
+        if (suffix == 0 || size == 0)
+            return range_t::unsatisfiable;
+        first = std::max<int64_t>(0, size - suffix);
+        last  = size - 1;
+        return range_t::valid;
+    }
+    if (!to_int(from, first))
+        return range_t::none;
+    last = size - 1;
+    if (!to.empty()) {
+        if (!to_int(to, last))
+            return range_t::none;
+        last = std::min(last, size - 1);
+    }
+    if (first >= size || first > last)
+        return range_t::unsatisfiable;
+    return range_t::valid;
+}
+
+// same format as mongoose, so both sending paths produce same tags
+std::string
+make_etag(const cs_stat_t& st) {
+    return format_string(
+        "\"%lx.%lld\"",
+        static_cast<unsigned long>(st.st_mtime),
+        static_cast<long long>(st.st_size));
+}
+
+bool
+is_not_modified(http_message* msg, const std::string& etag) {
+    auto hdr = mg_get_http_header(msg, "If-None-Match");
+    if (!hdr)
+        return false;
+    auto value = to_std_string(*hdr);
+    return value == "*" || value.find(etag) != std::string::npos;
+}
+
+std::string
+mime_type(const std::string& path) {
+    static const std::unordered_map<std::string, std::string> types = {
+        {".mkv", "video/x-matroska"},
+        {".mp4", "video/mp4"},
+        {".ts", "video/mp2t"},
+        {".flv", "video/x-flv"},
+        {".avi", "video/x-msvideo"},
+        {".mov", "video/quicktime"},
+        {".webm", "video/webm"},
+    };
+    auto ext = std::filesystem::path{path}.extension().string();
+    if (auto it = types.find(ext); it != types.cend())
+        return it->second;
+    return "application/octet-stream";
+}
+
+std::string
+http_time(time_t t) {
+    char buf[64] = {0};
+#if defined(_WIN32)
+    std::tm tm = *std::gmtime(&t);
+#else
+    std::tm tm{};
+    gmtime_r(&t, &tm);
+#endif
+    std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return buf;
+}
+
+} // namespace
+
+struct file_sender::impl {
+    struct transfer {
+        int     fd{-1};
+        int64_t offset{0};
+        int64_t remaining{0};
+    };
+    std::unordered_map<mg_connection*, transfer> transfers;
+
+    ~impl() {
+        for (auto& t : transfers)
+            release(t.second);
+    }
+
+    void release(transfer& t) {
+#if defined(__linux__)
+        if (t.fd >= 0)
+            ::close(t.fd);
+#endif
+        t.fd = -1;
+    }
+
+    bool send_file(
+        mg_connection*     mc,
+        http_message*      msg,
+        const std::string& path,
+        const cs_stat_t&   st,
+        const std::string& etag);
+};
+
+file_sender::file_sender() : pimpl{std::make_unique<impl>()} {}
+
+file_sender::~file_sender() {}
+
+void
+file_sender::serve(
+    mg_connection* mc, http_message* msg, const std::string& path) {
+    cs_stat_t st;
+    if (mg_stat(path.c_str(), &st) != 0) {
+        mg_http_send_error(mc, 404, nullptr);
+        mc->flags |= MG_F_SEND_AND_CLOSE;
+        return;
+    }
+    const auto& etag = make_etag(st);
+    if (is_not_modified(msg, etag)) {
+        mg_send_response_line(mc, 304, nullptr);
+        mg_printf(mc, "ETag: %s\r\nContent-Length: 0\r\n\r\n", etag.c_str());
+        mc->flags |= MG_F_SEND_AND_CLOSE;
+        return;
+    }
+    if (pimpl->send_file(mc, msg, path, st, etag))
+        return;
+    // ssl connections and other platforms, mongoose reads file by chunks
+    // into connection buffer on its poll events
+    const auto& type = mime_type(path);
+    mg_http_serve_file(
+        mc, msg, path.c_str(), mg_mk_str(type.c_str()), mg_mk_str(nullptr));
+}
+
+bool
+file_sender::impl::send_file(
+    mg_connection*     mc,
+    http_message*      msg,
+    const std::string& path,
+    const cs_stat_t&   st,
+    const std::string& etag) {
+#if defined(__linux__)
+    if (mc->flags & MG_F_SSL)
+        return false;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    int64_t size  = st.st_size;
+    int64_t first = 0;
+    int64_t last  = size - 1;
+    auto    range = range_t::none;
+    if (auto hdr = mg_get_http_header(msg, "Range"); hdr)
+        range = parse_range(to_std_string(*hdr), size, first, last);
+
+    if (range == range_t::unsatisfiable) {
+        ::close(fd);
+        mg_send_response_line(mc, 416, nullptr);
+        mg_printf(
+            mc,
+            "Content-Range: bytes */%lld\r\nContent-Length: 0\r\n\r\n",
+            static_cast<long long>(size));
+        mc->flags |= MG_F_SEND_AND_CLOSE;
+        return true;
+    }
+
+    const auto& type = mime_type(path);
+    mg_send_response_line(mc, range == range_t::valid ? 206 : 200, nullptr);
+    mg_printf(
+        mc,
+        "Last-Modified: %s\r\n"
+        "Accept-Ranges: bytes\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %lld\r\n"
+        "ETag: %s\r\n"
+        "Connection: close\r\n",
+        http_time(st.st_mtime).c_str(),
+        type.c_str(),
+        static_cast<long long>(last - first + 1),
+        etag.c_str());
+    if (range == range_t::valid)
+        mg_printf(
+            mc,
+            "Content-Range: bytes %lld-%lld/%lld\r\n",
+            static_cast<long long>(first),
+            static_cast<long long>(last),
+            static_cast<long long>(size));
+    mg_send(mc, "\r\n", 2);
+
+    auto& t     = transfers[mc];
+    t.fd        = fd;
+    t.offset    = first;
+    t.remaining = last - first + 1;
+    // body bypasses send buffer, ask for writability events of socket
+    mc->flags |= MG_F_USER_6;
+    return true;
+#else
+    (void)mc;
+    (void)msg;
+    (void)path;
+    (void)st;
+    (void)etag;
+    return false;
+#endif
+}
+
+void
+file_sender::on_poll(mg_connection* mc) {
+#if defined(__linux__)
+    auto it = pimpl->transfers.find(mc);
+    if (it == pimpl->transfers.end())
+        return;
+    // headers are flushed by mongoose first
+    if (mc->send_mbuf.len > 0)
+        return;
+
+    auto&   t    = it->second;
+    int64_t sent = 0;
+    while (t.remaining > 0 && sent < Send_Budget) {
+        off_t offset = static_cast<off_t>(t.offset);
+        auto  n      = ::sendfile(
+            static_cast<int>(mc->sock),
+            t.fd,
+            &offset,
+            static_cast<size_t>(std::min(t.remaining, Send_Budget - sent)));
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                return;
+            logWarn("http server: failed to send file err: %d", errno);
+            mc->flags |= MG_F_CLOSE_IMMEDIATELY;
+            on_close(mc);
+            return;
+        }
+        if (n == 0) { // file is truncated
+            t.remaining = 0;
+            break;
+        }
+        t.offset = offset;
+        t.remaining -= n;
+        sent += n;
+    }
+    mc->last_io_time = static_cast<time_t>(mg_time());
+    if (t.remaining > 0)
+        return;
+    mc->flags |= MG_F_SEND_AND_CLOSE;
+    on_close(mc);
+#else
+    (void)mc;
+#endif
+}
+
+void
+file_sender::on_close(mg_connection* mc) {
+    auto it = pimpl->transfers.find(mc);
+    if (it == pimpl->transfers.end())
+        return;
+    pimpl->release(it->second);
+    pimpl->transfers.erase(it);
+    mc->flags &= ~MG_F_USER_6;
+}
+
+} // namespace lxstreamer
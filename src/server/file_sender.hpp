@@ -0,0 +1,46 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#ifndef FILE_SENDER_HPP
+#define FILE_SENDER_HPP
+
+#include <memory>
+#include <string>
+
+struct mg_connection;
+struct http_message;
+
+namespace lxstreamer {
+
+/// serves files with range and etag support inside the http server loop
+/// without blocking it. on linux plain http connections are written by
+/// sendfile() directly from page cache, others fall back to mongoose file
+/// serving
+class file_sender
+{
+public:
+    explicit file_sender();
+    ~file_sender();
+
+    /// responds file at <path> to request <msg>
+    void serve(mg_connection* mc, http_message* msg, const std::string& path);
+
+    /// continues sending to <mc>, called on its poll and send events
+    void on_poll(mg_connection* mc);
+
+    /// releases transfer resources of <mc>
+    void on_close(mg_connection* mc);
+
+protected:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+} // namespace lxstreamer
+
+#endif // FILE_SENDER_HPP
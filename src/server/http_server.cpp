@@ -7,9 +7,11 @@
 ****************************************************************************/
 
 #include "http_server.hpp"
+#include "file_sender.hpp"
 #include "streamer_data.hpp"
 
 #include <filesystem>
+#include <list>
 #include <thread>
 
 namespace lxstreamer {
@@ -37,6 +39,7 @@ inline static std::unordered_map<error_t, http_error_t> ErrorMap = {
     {error_t::authentication_failed, http_error_t::unauthorized},
     {error_t::not_found, http_error_t::not_found},
     {error_t::not_ready, http_error_t::forbidden},
+    {error_t::busy, http_error_t::service_unavailable},
 };
 
 http_error_t
@@ -49,27 +52,47 @@ to_http_error(const std::error_code& ec) {
 
 const constexpr int Init_Try_Max = 200;
 
+const constexpr char* Recordings_Api = "/recordings/";
+
 } // namespace
 
 struct http_server::impl {
-    streamer_data&          super;
-    std::unique_ptr<mg_mgr> mgr{nullptr};
-    std::atomic_bool        running{false};
-    std::thread             worker;
-    mg_connection*          listener       = nullptr;
-    inline static bool      initialized    = false;
-    int                     init_try_count = 0;
+    // a listener with its own manager, connections accepted by it are
+    // handled on its thread
+    struct event_loop {
+        impl&                   server;
+        std::unique_ptr<mg_mgr> mgr{nullptr};
+        mg_connection*          listener = nullptr;
+        file_sender             files;
+
+        explicit event_loop(impl& s) : server{s} {}
+        ~event_loop() {
+            if (mgr)
+                mg_mgr_free(mgr.get());
+        }
+    };
+
+    streamer_data&                         super;
+    event_loop                             primary{*this};
+    std::list<std::unique_ptr<event_loop>> loops; // other than primary
+    std::list<std::thread>                 workers;
+    std::atomic_bool                       running{false};
+    std::thread                            worker;
+    inline static bool                     initialized    = false;
+    int                                    init_try_count = 0;
 
     explicit impl(streamer_data& s) : super{s} {}
     ~impl() {
         if (worker.joinable())
             worker.join();
-        mg_mgr_free(mgr.get());
+        stop_loops();
     }
 
-    bool setup();
+    bool setup(event_loop& loop);
     void prepare_ssl_cert_pathes();
     void initServer();
+    void start_loops();
+    void stop_loops();
 
     static void http_callback(mg_connection* mc, int ev, void* opaque) {
         if (ev == MG_EV_HTTP_REQUEST) {
@@ -78,10 +101,11 @@ struct http_server::impl {
                 mc->flags |= MG_F_SEND_AND_CLOSE;
                 return;
             }
-            auto* self = reinterpret_cast<impl*>(mc->listener->user_data);
-            auto  uri  = to_std_string(msg->uri);
+            auto* loop =
+                reinterpret_cast<event_loop*>(mc->listener->user_data);
+            auto uri = to_std_string(msg->uri);
             if (uri == "/stream") {
-                auto ec = self->super.make_stream(
+                auto ec = loop->server.super.make_stream(
                     mc,
                     to_std_string(msg->uri),
                     to_std_string(msg->query_string));
@@ -90,15 +114,81 @@ struct http_server::impl {
                         mc, static_cast<int>(to_http_error(ec)), nullptr);
                     mc->flags |= MG_F_SEND_AND_CLOSE;
                 }
+            } else if (uri == "/snapshot") {
+                loop->server.serve_snapshot(mc, msg);
+            } else if (uri.rfind(Recordings_Api, 0) == 0) {
+                loop->server.serve_recording(*loop, mc, msg, uri);
             } else {
                 logWarn("http server: unknown api: %s", uri);
                 mc->flags |= MG_F_SEND_AND_CLOSE;
                 return;
             }
+        } else if (ev == MG_EV_POLL || ev == MG_EV_SEND) {
+            if (mc->flags & MG_F_USER_6) {
+                auto* loop =
+                    reinterpret_cast<event_loop*>(mc->listener->user_data);
+                loop->files.on_poll(mc);
+            }
         } else if (ev == MG_EV_CLOSE) {
+            if (mc->flags & MG_F_USER_6) {
+                auto* loop =
+                    reinterpret_cast<event_loop*>(mc->listener->user_data);
+                loop->files.on_close(mc);
+            }
         }
     }
 
+    // serves /snapshot?source=<source>
+    void serve_snapshot(mg_connection* mc, http_message* msg) {
+        snapshot_t snapshot;
+        auto ec = super.snapshot(to_std_string(msg->query_string), snapshot);
+        if (ec) {
+            mg_http_send_error(
+                mc, static_cast<int>(to_http_error(ec)), nullptr);
+            mc->flags |= MG_F_SEND_AND_CLOSE;
+            return;
+        }
+        mg_send_response_line(mc, 200, nullptr);
+        mg_printf(
+            mc,
+            "Content-Type: image/jpeg\r\n"
+            "Content-Length: %d\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Connection: close\r\n\r\n",
+            static_cast<int>(snapshot.image.size()));
+        mg_send(
+            mc, snapshot.image.data(), static_cast<int>(snapshot.image.size()));
+        mc->flags |= MG_F_SEND_AND_CLOSE;
+    }
+
+    // serves /recordings/<source>/<file>
+    void serve_recording(
+        event_loop&        loop,
+        mg_connection*     mc,
+        http_message*      msg,
+        const std::string& uri) {
+        auto rest  = uri.substr(std::strlen(Recordings_Api));
+        auto slash = rest.find('/');
+        if (slash == std::string::npos) {
+            mg_http_send_error(mc, 400, nullptr);
+            mc->flags |= MG_F_SEND_AND_CLOSE;
+            return;
+        }
+        std::string path;
+        auto        ec = super.record_file(
+            rest.substr(0, slash),
+            rest.substr(slash + 1),
+            to_std_string(msg->query_string),
+            path);
+        if (ec) {
+            mg_http_send_error(
+                mc, static_cast<int>(to_http_error(ec)), nullptr);
+            mc->flags |= MG_F_SEND_AND_CLOSE;
+            return;
+        }
+        loop.files.serve(mc, msg, path);
+    }
+
     static void connect_handler(mg_connection* nc, int ev, void*) {
         auto* self = reinterpret_cast<impl*>(nc->user_data);
         if (ev == MG_EV_SEND) {
@@ -115,31 +205,33 @@ http_server::http_server(streamer_data& s) : pimpl{std::make_unique<impl>(s)} {}
 http_server::~http_server() {}
 
 bool
-http_server::impl::setup() {
-    ++init_try_count;
-    mgr = std::make_unique<mg_mgr>();
-    mg_mgr_init(mgr.get(), nullptr);
+http_server::impl::setup(event_loop& loop) {
+    if (&loop == &primary)
+        ++init_try_count;
+    loop.mgr = std::make_unique<mg_mgr>();
+    mg_mgr_init(loop.mgr.get(), nullptr);
 
-    const auto& address = format_string("tcp://0.0.0.0:%d", super.port);
+    const auto& address  = format_string("tcp://0.0.0.0:%d", super.port);
+    auto&       listener = loop.listener;
 
     if (super.https) {
         prepare_ssl_cert_pathes();
 
+        namespace fs          = std::filesystem;
+        const auto& cert_path = fs::absolute(fs::path{super.ssl_cert_path});
+        const auto& key_path  = fs::absolute(fs::path{super.ssl_key_path});
+        const auto& cert      = cert_path.string();
+        const auto& key       = key_path.string();
+
         struct mg_bind_opts bind_opts;
         memset(&bind_opts, 0, sizeof(bind_opts));
-        bind_opts.ssl_cert = std::filesystem::absolute(
-                                 std::filesystem::path{super.ssl_cert_path})
-                                 .string()
-                                 .c_str();
-        bind_opts.ssl_key =
-            std::filesystem::absolute(std::filesystem::path{super.ssl_key_path})
-                .string()
-                .c_str();
+        bind_opts.ssl_cert     = cert.c_str();
+        bind_opts.ssl_key      = key.c_str();
         const char* err        = nullptr;
         bind_opts.error_string = &err;
 
-        listener =
-            mg_bind_opt(mgr.get(), address.data(), http_callback, bind_opts);
+        listener = mg_bind_opt(
+            loop.mgr.get(), address.data(), http_callback, bind_opts);
         if (listener == nullptr) {
             if (init_try_count == Init_Try_Max)
                 logFatal(
@@ -149,16 +241,17 @@ http_server::impl::setup() {
             return false;
         }
         mg_set_protocol_http_websocket(listener);
-        listener->user_data = this;
+        listener->user_data = &loop;
     } else {
-        listener = mg_bind(mgr.get(), address.data(), http_callback);
+        listener = mg_bind(loop.mgr.get(), address.data(), http_callback);
         if (listener == nullptr) {
             logFatal("http server: failed to listen on: %s", address);
             return false;
         }
         mg_set_protocol_http_websocket(listener);
-        listener->user_data = this;
-        logInfo("http server listening on port: %d", super.port);
+        listener->user_data = &loop;
+        if (&loop == &primary)
+            logInfo("http server listening on port: %d", super.port);
     }
 
     return true;
@@ -190,22 +283,24 @@ http_server::impl::initServer() {
     if (init_try_count > Init_Try_Max)
         return;
     std::this_thread::sleep_for(std::chrono::milliseconds{10});
-    if (mgr) {
-        mg_mgr_free(mgr.get());
-        mgr.reset();
+    if (primary.mgr) {
+        mg_mgr_free(primary.mgr.get());
+        primary.mgr.reset();
     }
-    while (!setup()) {
+    // all listeners of the port should allow sharing it
+    mg_reuse_port = super.http_threads > 1 ? 1 : 0;
+    while (!setup(primary)) {
         if (init_try_count > Init_Try_Max)
             return;
         std::this_thread::sleep_for(std::chrono::milliseconds{10});
-        mg_mgr_free(mgr.get());
-        mgr.reset();
+        mg_mgr_free(primary.mgr.get());
+        primary.mgr.reset();
     }
 
     if (!super.https)
         return;
     auto client = mg_connect_ws(
-        mgr.get(),
+        primary.mgr.get(),
         connect_handler,
         format_string("wss://127.0.0.1:%d", super.port).data(),
         "wss",
@@ -214,6 +309,36 @@ http_server::impl::initServer() {
         client->user_data = this;
 }
 
+void
+http_server::impl::start_loops() {
+    stop_loops();
+#if defined(__linux__)
+    // kernel distributes new connections, and so handshakes and requests,
+    // between listeners of the port
+    for (size_t i = 1; i < super.http_threads; ++i) {
+        auto loop = std::make_unique<event_loop>(*this);
+        if (!setup(*loop)) {
+            logWarn("http server: failed to start event loop: %d", int(i));
+            break;
+        }
+        auto* l = loops.emplace_back(std::move(loop)).get();
+        workers.emplace_back([this, l]() {
+            while (super.running && running)
+                mg_mgr_poll(l->mgr.get(), 300);
+        });
+    }
+#endif
+}
+
+void
+http_server::impl::stop_loops() {
+    for (auto& w : workers)
+        if (w.joinable())
+            w.join();
+    workers.clear();
+    loops.clear();
+}
+
 void
 http_server::start() {
     if (pimpl->running || pimpl->worker.joinable())
@@ -221,10 +346,13 @@ http_server::start() {
     pimpl->worker = std::thread{[&]() {
         pimpl->initServer();
         pimpl->running = true;
+        if (pimpl->primary.listener)
+            pimpl->start_loops();
         while (pimpl->super.running && pimpl->running) {
-            mg_mgr_poll(pimpl->mgr.get(), 300);
+            mg_mgr_poll(pimpl->primary.mgr.get(), 300);
         }
         pimpl->running = false;
+        pimpl->stop_loops();
         if (pimpl->initialized)
             logInfo("http server finished");
         else {
@@ -3806,6 +3806,8 @@ static int mg_accept_conn(struct mg_connection *lc) {
   return 1;
 }
 
+int mg_reuse_port = 0;
+
 /* 'sa' must be an initialized address to bind to */
 static sock_t mg_open_listening_socket(union socket_address *sa, int type,
                                        int proto) {
@@ -3836,6 +3838,12 @@ static sock_t mg_open_listening_socket(union socket_address *sa, int type,
        */
       !setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (void *) &on, sizeof(on)) &&
 #endif
+#if defined(SO_REUSEPORT) && !defined(_WIN32)
+      /* lxstreamer: lets listeners of several event loops share the port */
+      (!mg_reuse_port || type != SOCK_STREAM ||
+       !setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (void *) &on,
+                   sizeof(on))) &&
+#endif
 #endif /* !MG_LWIP */
 
       !bind(sock, &sa->sa, sa_len) &&
@@ -4033,8 +4041,11 @@ time_t mg_socket_if_poll(struct mg_iface *iface, int timeout_ms) {
         mg_add_to_set(nc->sock, &read_set, &max_fd);
       }
 
+      /* lxstreamer: MG_F_USER_6 marks connections written out of send_mbuf
+       * (sendfile), wake up on writability for them as well */
       if (((nc->flags & MG_F_CONNECTING) && !(nc->flags & MG_F_WANT_READ)) ||
-          (nc->send_mbuf.len > 0 && !(nc->flags & MG_F_CONNECTING))) {
+          ((nc->send_mbuf.len > 0 || (nc->flags & MG_F_USER_6)) &&
+           !(nc->flags & MG_F_CONNECTING))) {
         mg_add_to_set(nc->sock, &write_set, &max_fd);
         mg_add_to_set(nc->sock, &err_set, &max_fd);
       }
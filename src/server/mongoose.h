@@ -3837,6 +3837,12 @@ struct mg_connection *mg_bind_opt(struct mg_mgr *mgr, const char *address,
                                         void *user_data),
                                   struct mg_bind_opts opts);
 
+/*
+ * lxstreamer: if non-zero, TCP listening sockets are opened with
+ * SO_REUSEPORT where supported, so several managers can listen on a port.
+ */
+extern int mg_reuse_port;
+
 /* Optional parameters to `mg_connect_opt()` */
 struct mg_connect_opts {
   void *user_data;           /* Initial value for connection's user_data */
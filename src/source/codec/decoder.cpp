@@ -24,8 +24,63 @@ struct decoder::impl {
     explicit impl(const source_data& sup) : super{sup} {}
 
     ~impl() {}
+
+    int receive_frames(
+        AVCodecContext*       dec,
+        const AVStream*       stream,
+        const AVPacket*       pkt,
+        std::list<frame_ref>& frames);
 };
 
+int
+decoder::impl::receive_frames(
+    AVCodecContext*       dec,
+    const AVStream*       stream,
+    const AVPacket*       pkt,
+    std::list<frame_ref>& frames) {
+    auto is_video = dec == ivid_decoder.get();
+    auto ret      = 0;
+    while (ret >= 0) {
+        frame frm;
+        ret = avcodec_receive_frame(dec, frm.get());
+        if (ret == AVERROR_EOF || ret == AVERROR(EAGAIN))
+            break;
+        else if (ret < 0)
+            return ret;
+
+        auto* f = frm.get();
+        if (is_video) {
+            f->pts       = f->best_effort_timestamp;
+            f->time_base = stream->time_base;
+        } else {
+            if (elapsed.elapsed() > std::chrono::seconds{5})
+                audio_rescale_last = AV_NOPTS_VALUE;
+            elapsed.start();
+            AVRational decoded_frame_tb;
+            if (f->pts != AV_NOPTS_VALUE) {
+                decoded_frame_tb = stream->time_base;
+            } else if (pkt && pkt->pts != AV_NOPTS_VALUE) {
+                f->pts           = pkt->pts;
+                decoded_frame_tb = stream->time_base;
+            } else {
+                f->pts           = pkt ? pkt->dts : AV_NOPTS_VALUE;
+                decoded_frame_tb = {1, AV_TIME_BASE};
+            }
+            if (f->pts != AV_NOPTS_VALUE)
+                f->pts = av_rescale_delta(
+                    decoded_frame_tb,
+                    f->pts,
+                    {1, f->sample_rate},
+                    frm.get()->nb_samples,
+                    &audio_rescale_last,
+                    {1, f->sample_rate});
+            f->time_base = {1, f->sample_rate};
+        }
+        frames.emplace_back(frm.get());
+    }
+    return 0;
+}
+
 decoder::decoder(const source_data& s) : pimpl{std::make_unique<impl>(s)} {}
 
 decoder::~decoder() {}
@@ -120,46 +175,32 @@ decoder::decode_frames(const AVPacket* pkt, std::list<frame_ref>& frames) {
             ffmpeg_make_error_string(ret));
         return ret;
     }
+    return pimpl->receive_frames(dec.get(), stream, pkt, frames);
+}
 
-    while (ret >= 0) {
-        frame frm;
-        ret = avcodec_receive_frame(dec.get(), frm.get());
-        if (ret == AVERROR_EOF || ret == AVERROR(EAGAIN))
-            break;
-        else if (ret < 0)
-            return ret;
+int
+decoder::flush(int stream_idx, std::list<frame_ref>& frames) {
+    auto is_video =
+        stream_idx == pimpl->super.demux_data.video_stream.stream_idx;
+    auto* dec =
+        is_video ? pimpl->ivid_decoder.get() : pimpl->iaud_decoder.get();
+    if (!dec || stream_idx < 0)
+        return 0;
+    // null packet enters draining mode
+    auto ret = avcodec_send_packet(dec, nullptr);
+    if (ret >= 0)
+        ret = pimpl->receive_frames(
+            dec, pimpl->super.input_ctx->streams[stream_idx], nullptr, frames);
+    avcodec_flush_buffers(dec);
+    return ret;
+}
 
-        auto* f = frm.get();
-        if (is_video) {
-            f->pts       = f->best_effort_timestamp;
-            f->time_base = stream->time_base;
-        } else {
-            if (pimpl->elapsed.elapsed() > std::chrono::seconds{5})
-                pimpl->audio_rescale_last = AV_NOPTS_VALUE;
-            pimpl->elapsed.start();
-            AVRational decoded_frame_tb;
-            if (f->pts != AV_NOPTS_VALUE) {
-                decoded_frame_tb = stream->time_base;
-            } else if (pkt->pts != AV_NOPTS_VALUE) {
-                f->pts           = pkt->pts;
-                decoded_frame_tb = stream->time_base;
-            } else {
-                f->pts           = pkt->dts;
-                decoded_frame_tb = {1, AV_TIME_BASE};
-            }
-            if (f->pts != AV_NOPTS_VALUE)
-                f->pts = av_rescale_delta(
-                    decoded_frame_tb,
-                    f->pts,
-                    {1, f->sample_rate},
-                    frm.get()->nb_samples,
-                    &pimpl->audio_rescale_last,
-                    {1, f->sample_rate});
-            f->time_base = {1, f->sample_rate};
-        }
-        frames.emplace_back(frm.get());
-    }
-    return 0;
+void
+decoder::reset() {
+    for (auto* dec : {pimpl->ivid_decoder.get(), pimpl->iaud_decoder.get()})
+        if (dec)
+            avcodec_flush_buffers(dec);
+    pimpl->audio_rescale_last = AV_NOPTS_VALUE;
 }
 
 } // namespace lxstreamer
@@ -29,6 +29,11 @@ public:
     AVCodecContext* audio_context() const;
     int             initialize(const AVStream*);
     int             decode_frames(const AVPacket*, std::list<frame_ref>&);
+    /// drains frames buffered in decoder of stream <stream_idx> and resets
+    /// it for next packets
+    int flush(int stream_idx, std::list<frame_ref>& frames);
+    /// discards frames buffered in decoders
+    void reset();
 
 protected:
     struct impl;
@@ -10,6 +10,10 @@
 #include "../source_data.hpp"
 #include "utils.hpp"
 
+#include <cstring>
+#include <deque>
+#include <vector>
+
 extern "C" {
 #include <libavutil/opt.h>
 }
@@ -116,6 +120,40 @@ check_sample_fmt(const AVCodec* codec, enum AVSampleFormat sample_fmt) {
     return 0;
 }
 
+/* check if frames of format can be played by any client: 8 bit 4:2:0 */
+bool
+is_playable_pix_fmt(AVPixelFormat format) {
+    const auto* desc = av_pix_fmt_desc_get(format);
+    return desc && !(desc->flags & AV_PIX_FMT_FLAG_HWACCEL) &&
+           desc->nb_components == 3 && desc->log2_chroma_w == 1 &&
+           desc->log2_chroma_h == 1 && desc->comp[0].depth == 8;
+}
+
+/* select pixel format of encoder closest to decoded one, so frames are
+ * converted only if encoder can't take them as they are. formats which
+ * some players can't decode are only used if encoder has no other one */
+AVPixelFormat
+select_pix_fmt(const AVCodec* codec, AVPixelFormat decoded) {
+    if (decoded == AV_PIX_FMT_NONE)
+        decoded = AV_PIX_FMT_YUV420P;
+    if (!codec->pix_fmts)
+        return is_playable_pix_fmt(decoded) ? decoded : AV_PIX_FMT_YUV420P;
+
+    std::vector<AVPixelFormat> playables;
+    for (const auto* p = codec->pix_fmts; *p != AV_PIX_FMT_NONE; ++p) {
+        if (*p == decoded && is_playable_pix_fmt(decoded))
+            return decoded;
+        if (is_playable_pix_fmt(*p))
+            playables.push_back(*p);
+    }
+    playables.push_back(AV_PIX_FMT_NONE);
+    return avcodec_find_best_pix_fmt_of_list(
+        playables.size() > 1 ? playables.data() : codec->pix_fmts,
+        decoded,
+        0,
+        nullptr);
+}
+
 /* select preferred samplerate if supported otherwise select some other one */
 int
 select_sample_rate(const AVCodec* codec, int preferred_sample_rate) {
@@ -167,30 +205,125 @@ select_channel_layout(
 
 namespace {
 
+constexpr const int     Gop_Duration       = 2; // seconds
+constexpr const double  Default_Frame_Rate = 25;
+constexpr const int64_t Idle_Time          = 2; // seconds without frames
+
+bool
+is_encoder(const AVCodec* codec, const char* name) {
+    return std::strcmp(codec->name, name) == 0;
+}
+
+const char*
+value_or(const std::string& value, const char* default_value) {
+    return value.empty() ? default_value : value.c_str();
+}
+
+// fills private options of <codec> for a low latency live encoding, the
+// profile fields of <config> override the defaults
+void
+set_live_options(
+    const encoding_t& config, const AVCodec* codec, dictionary& opts) {
+    const auto& c   = config;
+    auto        crf = c.rate_control == rate_control_t::crf;
+    if (is_encoder(codec, "libx264") || is_encoder(codec, "libx265")) {
+        auto is_x264 = is_encoder(codec, "libx264");
+        opts.set("preset", value_or(c.preset, "veryfast"));
+        opts.set("tune", value_or(c.tune, "zerolatency"));
+        opts.set("forced-idr", 1); // forced key frames start a new gop
+        if (crf)
+            opts.set("crf", c.crf >= 0 ? c.crf : is_x264 ? 23 : 28);
+        if (c.lookahead >= 0 && is_x264)
+            opts.set("rc-lookahead", c.lookahead);
+        else if (c.lookahead >= 0)
+            opts.set(
+                "x265-params",
+                ("rc-lookahead=" + std::to_string(c.lookahead)).c_str());
+        if (c.rate_control == rate_control_t::cbr && is_x264)
+            opts.set("nal-hrd", "cbr");
+    } else if (is_encoder(codec, "libvpx-vp9")) {
+        opts.set("deadline", "realtime");
+        opts.set("cpu-used", value_or(c.preset, "8"));
+        opts.set("lag-in-frames", std::max(c.lookahead, 0));
+        opts.set("row-mt", 1);
+        if (crf)
+            opts.set("crf", c.crf >= 0 ? c.crf : 32);
+    } else if (is_encoder(codec, "libsvtav1")) {
+        opts.set("preset", value_or(c.preset, "10"));
+        if (crf)
+            opts.set("crf", c.crf >= 0 ? c.crf : 35);
+        if (c.lookahead >= 0)
+            opts.set(
+                "svtav1-params",
+                ("lookahead=" + std::to_string(c.lookahead)).c_str());
+    } else if (is_encoder(codec, "librav1e")) {
+        opts.set("speed", value_or(c.preset, "10"));
+        opts.set("rav1e-params", "low_latency=true");
+        if (crf)
+            opts.set("qp", c.crf >= 0 ? c.crf : 100);
+    } else if (is_encoder(codec, "libaom-av1")) {
+        opts.set("usage", "realtime");
+        opts.set("cpu-used", value_or(c.preset, "8"));
+        opts.set("lag-in-frames", std::max(c.lookahead, 0));
+        if (crf)
+            opts.set("crf", c.crf >= 0 ? c.crf : 35);
+    } else if (is_encoder(codec, "h264_mf")) {
+        opts.set("scenario", "live_streaming");
+        if (c.rate_control == rate_control_t::cbr)
+            opts.set("rate_control", "cbr");
+    } else {
+        // unknown encoder, passes profile as is
+        if (!c.preset.empty())
+            opts.set("preset", c.preset.c_str());
+        if (!c.tune.empty())
+            opts.set("tune", c.tune.c_str());
+        if (crf && c.crf >= 0)
+            opts.set("crf", c.crf);
+    }
+}
+
 struct encoder_struct {
     using codec_context_t = unique_ptr<AVCodecContext>;
     const AVCodec*  encoder{nullptr};
     codec_context_t enc_ctx{nullptr};
     elapsed_timer   tt;
+    bool            global_header{false};
+    bool            keyframe{false}; // next frame should be a key frame
+    int64_t         next_pts{AV_NOPTS_VALUE}; // of next frame to be taken
 };
 
 } // namespace
 
 struct encoder::impl {
 
-    const source_data&                             super;
-    std::unordered_map<encoding_t, encoder_struct> encoders;
-    std::mutex                                     mutex;
-
-    explicit impl(const source_data& sup) : super{sup} {}
+    // items are indexed by encoding id, deques keep them in place while new
+    // ones are interned, so an encoder can be used out of the main lock
+    const source_data&                          super;
+    std::deque<encoder_struct>                  encoders;
+    std::deque<std::mutex>                      locks; // lock of each encoder
+    std::deque<encoding_t>                      configs;
+    std::unordered_map<encoding_t, encoding_id> ids;
+    mutable std::mutex                          mutex;
+    encoder_stats                               stats;
+
+    explicit impl(const source_data& sup) : super{sup} {
+        // invalid encoding has id 0
+        configs.emplace_back();
+        encoders.emplace_back();
+        locks.emplace_back();
+        ids.emplace(configs.front(), 0);
+    }
 
     ~impl() {}
 
     void set_encoder_video_settings(
-        const encoding_t& config, AVCodecContext* codec_ctx);
+        const encoding_t& config,
+        AVCodecContext*   codec_ctx,
+        const AVCodec*    codec);
     void set_encoder_audio_settings(
         const encoding_t& config, AVCodecContext* codec_ctx, AVCodec* codec);
 
+    int open(const encoding_t& config, encoder_struct& enc);
     int encode_packets(
         AVCodecContext*        enc_ctx,
         const AVFrame*         frm,
@@ -199,40 +332,37 @@ struct encoder::impl {
 
 void
 encoder::impl::set_encoder_video_settings(
-    const encoding_t& config, AVCodecContext* codec_ctx) {
-    uint64_t max_bitrate     = config.max_bitrate * 1000;
-    auto     average_bitrate = max_bitrate / (super.is_webcam ? 4 : 2);
-    uint64_t buf_size        = average_bitrate;
-    auto     ret =
-        av_opt_set_int(codec_ctx, "b", average_bitrate, AV_OPT_SEARCH_CHILDREN);
-    if (ret != 0)
-        logError(
-            "failed setting encoder parameter <b> err:%d, %s",
-            ret,
-            ffmpeg_make_error_string(ret));
-
-    ret = av_opt_set_int(
-        codec_ctx, "maxrate", max_bitrate, AV_OPT_SEARCH_CHILDREN);
-    if (ret != 0)
-        logError(
-            "failed setting encoder parameter <maxrate> err:%d, %s",
-            ret,
-            ffmpeg_make_error_string(ret));
-
-    //    av_opt_set_int(codec_ctx, "minrate", 1000, AV_OPT_SEARCH_CHILDREN);
-    //    if (ret != 0)
-    //        logError(
-    //            "failed setting encoder parameter <minrate> err:%d, %s",
-    //            ret,
-    //            ffmpeg_make_error_string(ret));
+    const encoding_t& config, AVCodecContext* codec_ctx, const AVCodec* codec) {
+    int64_t max_bitrate     = config.max_bitrate * 1000;
+    auto    average_bitrate = max_bitrate / (super.is_webcam ? 4 : 2);
+    auto    min_bitrate     = int64_t{0};
+    auto    buf_size        = average_bitrate;
+    if (config.rate_control == rate_control_t::cbr) {
+        average_bitrate = max_bitrate;
+        min_bitrate     = max_bitrate;
+        buf_size        = max_bitrate;
+    } else if (config.rate_control == rate_control_t::crf)
+        average_bitrate = max_bitrate; // upper limit of constrained quality
+
+    auto set_int = [codec_ctx](const char* name, int64_t value) {
+        auto ret =
+            av_opt_set_int(codec_ctx, name, value, AV_OPT_SEARCH_CHILDREN);
+        if (ret != 0)
+            logError(
+                "failed setting encoder parameter <%s> err:%d, %s",
+                name,
+                ret,
+                ffmpeg_make_error_string(ret));
+    };
+    set_int("b", average_bitrate);
+    set_int("maxrate", max_bitrate);
+    if (min_bitrate > 0)
+        set_int("minrate", min_bitrate);
+    set_int("bufsize", buf_size);
 
-    ret =
-        av_opt_set_int(codec_ctx, "bufsize", buf_size, AV_OPT_SEARCH_CHILDREN);
-    if (ret != 0)
-        logError(
-            "failed setting encoder parameter <bufsize> err:%d, %s",
-            ret,
-            ffmpeg_make_error_string(ret));
+    codec_ctx->max_b_frames = std::max(config.b_frames, 0);
+    if (config.threads > 0)
+        codec_ctx->thread_count = config.threads;
 
     auto dec_ctx = super.idecoder.video_context();
     if (!dec_ctx)
@@ -247,14 +377,28 @@ encoder::impl::set_encoder_video_settings(
     codec_ctx->sample_aspect_ratio =
         dec_ctx ? dec_ctx->sample_aspect_ratio : AVRational{0, 1};
 
-    codec_ctx->pix_fmt = AVPixelFormat::AV_PIX_FMT_YUV420P;
+    codec_ctx->pix_fmt = select_pix_fmt(codec, dec_ctx->pix_fmt);
+    // frame rate of config only drops frames, never duplicates them
+    auto in_rate = dec_ctx->framerate.num > 0
+                     ? dec_ctx->framerate
+                     : av_d2q(Default_Frame_Rate, AV_TIME_BASE);
+    codec_ctx->framerate =
+        config.frame_rate > 0 && av_cmp_q({config.frame_rate, 1}, in_rate) < 0
+            ? AVRational{config.frame_rate, 1}
+            : in_rate;
     /* video time_base can be set to whatever is handy and supported by
-     * encoder
+     * encoder, frames keep timestamps of input stream so decimated ones
+     * keep their times and packets need no rescaling
      */
-    codec_ctx->time_base =
-        dec_ctx
-            ? av_inv_q(dec_ctx->framerate)
-            : AVRational{AV_TIME_BASE / (config.frame_rate / 2), AV_TIME_BASE};
+    const auto* stream   = super.demux_data.video_stream.stream;
+    codec_ctx->time_base = stream && stream->time_base.num > 0
+                             ? stream->time_base
+                             : av_inv_q(codec_ctx->framerate);
+
+    codec_ctx->gop_size = config.gop;
+    if (codec_ctx->gop_size <= 0)
+        codec_ctx->gop_size =
+            static_cast<int>(av_q2d(codec_ctx->framerate) * Gop_Duration);
 }
 
 void
@@ -309,6 +453,57 @@ encoder::impl::set_encoder_audio_settings(
     codec_ctx->time_base = AVRational{1, codec_ctx->sample_rate};
 }
 
+int
+encoder::impl::open(const encoding_t& config, encoder_struct& enc) {
+    enc.encoder = get_encoder(config.codec);
+    if (!enc.encoder) {
+        logError("encoder not found: src: %s", super.iargs.name);
+        return AVERROR_INVALIDDATA;
+    }
+    enc.enc_ctx.reset(avcodec_alloc_context3(enc.encoder));
+    auto* codec_ctx = enc.enc_ctx.get();
+    if (!codec_ctx) {
+        logError(
+            "failed to allocate encoder context: src: %s", super.iargs.name);
+        return AVERROR(ENOMEM);
+    }
+
+    if (is_video(config))
+        set_encoder_video_settings(config, codec_ctx, enc.encoder);
+    else
+        set_encoder_audio_settings(
+            config, codec_ctx, const_cast<AVCodec*>(enc.encoder));
+
+    if (enc.global_header) {
+        codec_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    dictionary opts;
+    if (is_video(config))
+        set_live_options(config, enc.encoder, opts);
+    auto ret = avcodec_open2(codec_ctx, enc.encoder, opts.ref());
+    if (ret >= 0 && opts.get())
+        logWarn(
+            "encoder options not supported: src: %s encoder: %s options: %s",
+            super.iargs.name,
+            enc.encoder->name,
+            to_string(opts));
+    if (ret < 0) {
+        logError(
+            "failed opening encoder: src: %s err: %d, %s",
+            super.iargs.name,
+            ret,
+            ffmpeg_make_error_string(ret));
+        return ret;
+    }
+
+    logTrace(
+        "encoder opened: src: %s encoder: %s",
+        super.iargs.name,
+        enc.encoder->name);
+    return 0;
+}
+
 int
 encoder::impl::encode_packets(
     AVCodecContext*        enc_ctx,
@@ -322,7 +517,6 @@ encoder::impl::encode_packets(
             ret,
             ffmpeg_make_error_string(ret));
         return ret;
-        return ret;
     }
 
     while (ret >= 0) {
@@ -330,12 +524,16 @@ encoder::impl::encode_packets(
         ret = avcodec_receive_packet(enc_ctx, pkt.get());
         if (ret == AVERROR_EOF || ret == AVERROR(EAGAIN))
             break;
+        else if (ret < 0)
+            return ret;
 
         auto is_audio = enc_ctx->codec_type == AVMEDIA_TYPE_AUDIO;
 
         auto dec_ctx = !is_audio ? super.idecoder.video_context()
                                  : super.idecoder.audio_context();
-        if (!dec_ctx || is_audio) {
+        if (!frm) // drained packets keep their encoder timestamps
+            pkt.get()->time_base = enc_ctx->time_base;
+        else if (!dec_ctx || is_audio) {
             pkt.get()->pts       = frm->pts;
             pkt.get()->dts       = pkt.get()->pts;
             pkt.get()->duration  = is_audio ? frm->duration : 0;
@@ -354,80 +552,212 @@ encoder::encoder(const source_data& s) : pimpl{std::make_unique<impl>(s)} {}
 
 encoder::~encoder() {}
 
+encoding_id
+encoder::intern(const encoding_t& config) {
+    std::scoped_lock lock{pimpl->mutex};
+    auto [it, added] = pimpl->ids.emplace(config, pimpl->configs.size());
+    if (added) {
+        pimpl->configs.push_back(config);
+        pimpl->encoders.emplace_back();
+        pimpl->locks.emplace_back();
+    }
+    return it->second;
+}
+
+const encoding_t&
+encoder::config(encoding_id id) const {
+    std::scoped_lock lock{pimpl->mutex};
+    // deque keeps references of interned items valid
+    return id < pimpl->configs.size() ? pimpl->configs[id]
+                                      : pimpl->configs.front();
+}
+
 AVCodecContext*
-encoder::context(const encoding_t& config) const {
-    if (auto it = pimpl->encoders.find(config); it != pimpl->encoders.cend())
-        return pimpl->encoders[config].enc_ctx.get();
-    return nullptr;
+encoder::context(encoding_id id) const {
+    std::scoped_lock lock{pimpl->mutex};
+    return id < pimpl->encoders.size() ? pimpl->encoders[id].enc_ctx.get()
+                                       : nullptr;
 }
 
 int
-encoder::initialize(const encoding_t& config, const AVFormatContext* octx) {
+encoder::initialize(encoding_id id, const AVFormatContext* octx) {
+    const encoding_t* config = nullptr;
+    {
+        std::scoped_lock lock{pimpl->mutex};
+        if (id == 0 || id >= pimpl->encoders.size())
+            return AVERROR(EINVAL);
+        std::scoped_lock slot{pimpl->locks[id]};
+        auto&            enc = pimpl->encoders[id];
+        if (enc.enc_ctx) {
+            // an idle encoder may hold frames of its last users
+            if (enc.tt.seconds() >= Idle_Time) {
+                if (enc.encoder->capabilities & AV_CODEC_CAP_ENCODER_FLUSH)
+                    avcodec_flush_buffers(enc.enc_ctx.get());
+                enc.tt.start();
+                ++pimpl->stats.reuses;
+            }
+            // new writer starts decoding from next frame
+            enc.keyframe = true;
+            return 0;
+        }
+        // deque keeps references of interned items valid
+        config = &pimpl->configs[id];
+    }
+
+    // opening may take tens of ms, so other encodings are not locked by it
+    encoder_struct fresh;
+    fresh.global_header = octx->oformat->flags & AVFMT_GLOBALHEADER;
+    if (auto ret = pimpl->open(*config, fresh); ret < 0)
+        return ret;
+
     std::scoped_lock lock{pimpl->mutex};
-    if (pimpl->encoders.find(config) != pimpl->encoders.cend())
+    std::scoped_lock slot{pimpl->locks[id]};
+    auto&            enc = pimpl->encoders[id];
+    // another writer may have opened it meanwhile
+    if (enc.enc_ctx) {
+        enc.keyframe = true;
         return 0;
-    encoder_struct enc;
-    enc.encoder = get_encoder(config.codec);
-    if (!enc.encoder) {
-        logError("encoder not found: src: %s", pimpl->super.iargs.name);
-        return AVERROR_INVALIDDATA;
-    }
-    auto* codec_ctx = avcodec_alloc_context3(enc.encoder);
-    if (!codec_ctx) {
-        logError(
-            "failed to allocate encoder context: src: %s",
-            pimpl->super.iargs.name);
-        return AVERROR(ENOMEM);
     }
+    enc = std::move(fresh);
+    ++pimpl->stats.opens;
+    return 0;
+}
 
-    if (is_video(config))
-        pimpl->set_encoder_video_settings(config, codec_ctx);
-    else
-        pimpl->set_encoder_audio_settings(
-            config, codec_ctx, const_cast<AVCodec*>(enc.encoder));
-
-    if (octx->oformat->flags & AVFMT_GLOBALHEADER) {
-        codec_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+int
+encoder::encode_packets(
+    encoding_id id, const AVFrame* frm, std::list<packet_ref>& packets) {
+    std::unique_lock<std::mutex> lock{pimpl->mutex};
+    if (id >= pimpl->encoders.size() || !pimpl->encoders[id].enc_ctx)
+        return AVERROR_ENCODER_NOT_FOUND;
+    // other encoders may run in parallel, intern may grow the deques
+    // meanwhile, so items are taken before unlocking
+    std::scoped_lock slot{pimpl->locks[id]};
+    auto&            enc   = pimpl->encoders[id];
+    bool             video = is_video(pimpl->configs[id]);
+    lock.unlock();
+    enc.tt.start();
+    if (enc.keyframe && frm && video) {
+        enc.keyframe = false;
+        frame_ref key{frm};
+        key->pict_type = AV_PICTURE_TYPE_I;
+        return pimpl->encode_packets(enc.enc_ctx.get(), key.get(), packets);
     }
+    return pimpl->encode_packets(enc.enc_ctx.get(), frm, packets);
+}
 
-    /* Third parameter can be used to pass settings to encoder */
-    auto ret = avcodec_open2(codec_ctx, enc.encoder, nullptr);
-    if (ret < 0) {
-        logError(
-            "failed opening encoder: src: %s err: %d, %s",
-            pimpl->super.iargs.name,
-            ret,
-            ffmpeg_make_error_string(ret));
+int
+encoder::flush(encoding_id id, std::list<packet_ref>& packets) {
+    std::scoped_lock lock{pimpl->mutex};
+    if (id >= pimpl->encoders.size() || !pimpl->encoders[id].enc_ctx)
+        return AVERROR_ENCODER_NOT_FOUND;
+    std::scoped_lock slot{pimpl->locks[id]};
+    auto&            enc = pimpl->encoders[id];
+    // null frame enters draining mode
+    auto ret = pimpl->encode_packets(enc.enc_ctx.get(), nullptr, packets);
+    enc.next_pts = AV_NOPTS_VALUE;
+    if (enc.encoder->capabilities & AV_CODEC_CAP_ENCODER_FLUSH) {
+        avcodec_flush_buffers(enc.enc_ctx.get());
         return ret;
     }
 
-    enc.enc_ctx.reset(codec_ctx);
-    pimpl->encoders[config] = std::move(enc);
+    // a drained encoder can't take frames anymore, reopens it
+    const_cast<source_data&>(pimpl->super)
+        .iresampler.remove(enc.enc_ctx.get());
+    encoder_struct fresh;
+    fresh.global_header = enc.global_header;
+    auto nret           = pimpl->open(pimpl->configs[id], fresh);
+    enc                 = std::move(fresh);
+    if (nret >= 0)
+        ++pimpl->stats.opens;
+    return nret < 0 ? nret : ret;
+}
 
-    return 0;
+void
+encoder::request_keyframe(encoding_id id) {
+    std::scoped_lock lock{pimpl->mutex};
+    if (id < pimpl->encoders.size()) {
+        std::scoped_lock slot{pimpl->locks[id]};
+        pimpl->encoders[id].keyframe = true;
+    }
 }
 
-int
-encoder::encode_packets(
-    const encoding_t&      config,
-    const AVFrame*         frm,
-    std::list<packet_ref>& packets) {
+bool
+encoder::take_frame(encoding_id id, const AVFrame* frm) {
     std::scoped_lock lock{pimpl->mutex};
-    if (pimpl->encoders.find(config) == pimpl->encoders.cend())
-        return AVERROR_ENCODER_NOT_FOUND;
-    pimpl->encoders[config].tt.start();
-    return pimpl->encode_packets(
-        pimpl->encoders[config].enc_ctx.get(), frm, packets);
+    if (id >= pimpl->encoders.size() || !pimpl->encoders[id].enc_ctx ||
+        !frm || frm->pts == AV_NOPTS_VALUE)
+        return true;
+    std::scoped_lock slot{pimpl->locks[id]};
+    auto&            enc  = pimpl->encoders[id];
+    const auto*      ctx  = enc.enc_ctx.get();
+    const AVRational rate = {pimpl->configs[id].frame_rate, 1};
+    // frame rate of encoder is of config only if it's lower than input
+    if (rate.num <= 0 || av_cmp_q(ctx->framerate, rate) != 0)
+        return true;
+    auto step = av_rescale_q(1, av_inv_q(rate), frm->time_base);
+    if (step <= 0)
+        return true;
+    // half a frame early is on time, jittery timestamps don't drop frames
+    auto early = frm->duration > 0 ? frm->duration / 2 : 0;
+    if (enc.next_pts != AV_NOPTS_VALUE && frm->pts + early < enc.next_pts &&
+        frm->pts >= enc.next_pts - step)
+        return false;
+    // follows the grid of taken frames, restarts it on gaps and seeks
+    enc.next_pts = enc.next_pts == AV_NOPTS_VALUE ||
+                           frm->pts < enc.next_pts - step ||
+                           frm->pts >= enc.next_pts + step
+                     ? frm->pts + step
+                     : enc.next_pts + step;
+    return true;
 }
 
 void
 encoder::prune() {
     std::scoped_lock lock{pimpl->mutex};
-    for (auto it = pimpl->encoders.begin(); it != pimpl->encoders.end();)
-        if (it->second.tt.seconds() > 10)
-            it = pimpl->encoders.erase(it);
-        else
-            ++it;
+    auto&            d       = *pimpl;
+    const auto&      args    = d.super.iargs;
+    auto             timeout = static_cast<int64_t>(args.encoder_idle_timeout);
+    size_t           open    = 0;
+    auto             evict   = [&](encoding_id id) {
+        std::scoped_lock slot{d.locks[id]};
+        auto&            enc = d.encoders[id];
+        // resampler keeps the context of audio encoders
+        const_cast<source_data&>(d.super).iresampler.remove(
+            enc.enc_ctx.get());
+        enc = encoder_struct{};
+        ++d.stats.evictions;
+    };
+    for (encoding_id id = 0; id < d.encoders.size(); ++id) {
+        const auto& enc = d.encoders[id];
+        if (enc.enc_ctx && enc.tt.seconds() > std::max(timeout, Idle_Time))
+            evict(id);
+        else if (enc.enc_ctx)
+            ++open;
+    }
+
+    // closes least recently used idle encoders beyond pool size
+    for (; open > args.encoder_pool_size; --open) {
+        encoding_id lru = 0;
+        for (encoding_id id = 1; id < d.encoders.size(); ++id) {
+            const auto& enc = d.encoders[id];
+            if (enc.enc_ctx && enc.tt.seconds() >= Idle_Time &&
+                (lru == 0 || enc.tt.elapsed() > d.encoders[lru].tt.elapsed()))
+                lru = id;
+        }
+        if (lru == 0)
+            break;
+        evict(lru);
+    }
+}
+
+encoder_stats
+encoder::stats() const {
+    std::scoped_lock lock{pimpl->mutex};
+    auto             stats = pimpl->stats;
+    stats.size             = 0;
+    for (const auto& enc : pimpl->encoders)
+        stats.size += enc.enc_ctx ? 1 : 0;
+    return stats;
 }
 
 } // namespace lxstreamer
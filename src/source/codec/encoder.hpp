@@ -11,6 +11,7 @@
 
 #include "common_types.hpp"
 #include "ffmpeg_types.hpp"
+#include "utils.hpp"
 
 #include <list>
 #include <memory>
@@ -35,26 +36,54 @@ init_resolution(encoding_t& enc, int input_width = 0, int input_height = 0);
 const AVCodec*
 get_encoder(codec_t codec);
 
+/// dense id of an encoding interned by encoder, 0 is invalid encoding
+using encoding_id = size_t;
+
 struct encoder_config {
-    encoding_t video;
-    encoding_t audio;
+    encoding_t  video;
+    encoding_t  audio;
+    encoding_id video_id{0}; ///< interned id of video
+    encoding_id audio_id{0}; ///< interned id of audio
+};
+
+/// counters of encoders of a source
+struct encoder_stats {
+    size_t size{0};      ///< open encoders, including idle ones
+    size_t opens{0};     ///< encoders opened
+    size_t reuses{0};    ///< idle encoders reused instead of opening one
+    size_t evictions{0}; ///< encoders closed by idle timeout or pool size
 };
 
-/// encoder holding contextes with different settings
+/// encoder holding contextes with different settings. idle encoders are
+/// kept warm in a pool to be reused by next viewers with same settings
 class encoder final
 {
 public:
     explicit encoder(const source_data&);
     ~encoder();
 
-    AVCodecContext* context(const encoding_t& config) const;
-    int initialize(const encoding_t& config, const AVFormatContext* octx);
+    /// returns id of <config>, so per packet calls index encoders by it
+    /// instead of hashing configs. should be called on writer setup
+    encoding_id       intern(const encoding_t& config);
+    const encoding_t& config(encoding_id id) const;
+
+    AVCodecContext* context(encoding_id id) const;
+    int initialize(encoding_id id, const AVFormatContext* octx);
+    /// encoders of different ids can encode in parallel
     int encode_packets(
-        const encoding_t&      config,
-        const AVFrame*         frm,
-        std::list<packet_ref>& packets);
-    /// prunes unused encoders
+        encoding_id id, const AVFrame* frm, std::list<packet_ref>& packets);
+    /// drains packets buffered in encoder of <id> and resets it for next
+    /// frames, encoders which can't be reset are reopened
+    int flush(encoding_id id, std::list<packet_ref>& packets);
+    /// makes next frame encoded by <id> a key frame
+    void request_keyframe(encoding_id id);
+    /// returns if video frame <frm> should be encoded by <id> to keep frame
+    /// rate of its config, others are dropped before being scaled
+    bool take_frame(encoding_id id, const AVFrame* frm);
+    /// closes encoders idle more than encoder_idle_timeout of source and
+    /// least recently used idle ones beyond its encoder_pool_size
     void prune();
+    encoder_stats stats() const;
 
 protected:
     struct impl;
@@ -68,11 +97,24 @@ namespace std {
 
 template <> struct hash<lxstreamer::encoding_t> {
     auto operator()(const lxstreamer::encoding_t& h) const {
-        return std::hash<lxstreamer::codec_t>{}(h.codec) ^
-               std::hash<int>{}(h.height) ^ std::hash<size_t>{}(h.max_bitrate) ^
-               std::hash<int64_t>{}(h.sample_rate) ^
-               std::hash<string>{}(h.sample_fmt) ^
-               std::hash<string>{}(h.channel_layout);
+        size_t seed = 0;
+        lxstreamer::hash_combine(seed, h.codec);
+        lxstreamer::hash_combine(seed, h.width);
+        lxstreamer::hash_combine(seed, h.height);
+        lxstreamer::hash_combine(seed, h.max_bitrate);
+        lxstreamer::hash_combine(seed, h.frame_rate);
+        lxstreamer::hash_combine(seed, h.sample_rate);
+        lxstreamer::hash_combine(seed, h.sample_fmt);
+        lxstreamer::hash_combine(seed, h.channel_layout);
+        lxstreamer::hash_combine(seed, h.preset);
+        lxstreamer::hash_combine(seed, h.tune);
+        lxstreamer::hash_combine(seed, h.rate_control);
+        lxstreamer::hash_combine(seed, h.crf);
+        lxstreamer::hash_combine(seed, h.gop);
+        lxstreamer::hash_combine(seed, h.b_frames);
+        lxstreamer::hash_combine(seed, h.lookahead);
+        lxstreamer::hash_combine(seed, h.threads);
+        return seed;
     }
 };
 
@@ -17,7 +17,9 @@ struct resample_config {
     bool operator==(const resample_config& o) const {
         if (!src_ctx || !dest_ctx || !o.src_ctx || !o.dest_ctx)
             return true;
-        return src_ctx->sample_fmt == o.src_ctx->sample_fmt &&
+        // buffered samples belong to one encoder
+        return dest_ctx == o.dest_ctx &&
+               src_ctx->sample_fmt == o.src_ctx->sample_fmt &&
                src_ctx->sample_rate == o.src_ctx->sample_rate &&
                !av_channel_layout_compare(
                    &src_ctx->ch_layout, &o.src_ctx->ch_layout) &&
@@ -57,164 +59,193 @@ template <> struct hash<resample_config> {
 namespace lxstreamer {
 namespace {
 
-struct filter_data {
-    resample_config               config;
-    std::unique_ptr<filter_graph> filter =
-        std::unique_ptr<filter_graph>{new filter_graph};
-    AVFilterContext* buffersrc_ctx{nullptr};
-    AVFilterContext* buffersink_ctx{nullptr};
-    int64_t          first_pts{0};
-    elapsed_timer    tt;
+struct resample_data {
+    resample_config         config;
+    unique_ptr<SwrContext>  swr{nullptr};
+    unique_ptr<AVAudioFifo> fifo{nullptr}; // converted samples to be framed
+    frame                   converted;     // reused buffer of conversions
+    int                     capacity{0};   // samples of converted
+    int64_t                 next_pts{AV_NOPTS_VALUE}; // in 1/dest rate
+    elapsed_timer           tt;
 };
 
 } // namespace
 
 struct resampler::impl {
 
-    const source_data&                               super;
-    std::unordered_map<resample_config, filter_data> filters;
+    const source_data&                                 super;
+    std::unordered_map<resample_config, resample_data> resamples;
 
     explicit impl(const source_data& sup) : super{sup} {}
 
     ~impl() {}
 
-    int init_filters(filter_data& fd);
+    int init_resample(resample_data& rd);
+    int reserve(resample_data& rd, int nb_samples);
+    int convert(resample_data& rd, const AVFrame* src);
 
     std::list<frame>
     make_frames(const AVFrame* src, const resample_config& config);
+    void receive_frames(resample_data& rd, bool last, std::list<frame>& frames);
 };
 
 int
-resampler::impl::init_filters(filter_data& fd) {
-    fd.filter->realloc();
-    int  ret   = 0;
-    auto graph = fd.filter->get();
-    if (!graph)
-        return AVERROR(ENOMEM);
-
-    auto& sctx = fd.config.src_ctx;
-    auto& dctx = fd.config.dest_ctx;
+resampler::impl::init_resample(resample_data& rd) {
+    auto& sctx = rd.config.src_ctx;
+    auto& dctx = rd.config.dest_ctx;
     if (sctx->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC)
         av_channel_layout_default(
             &sctx->ch_layout, sctx->ch_layout.nb_channels);
 
-    char src_ch_desc[64];
-    char dest_ch_desc[64];
-    av_channel_layout_describe(
-        &sctx->ch_layout, src_ch_desc, sizeof(src_ch_desc));
-    av_channel_layout_describe(
-        &dctx->ch_layout, dest_ch_desc, sizeof(dest_ch_desc));
-    std::string input = format_string(
-        "abuffer=time_base=%d/"
-        "%d:sample_rate=%d:sample_fmt=%s:channel_layout=%s [in]; ",
-        sctx->time_base.num,
-        sctx->time_base.den,
-        sctx->sample_rate,
-        av_get_sample_fmt_name(sctx->sample_fmt),
-        src_ch_desc);
-    std::string aformat_descr = format_string(
-        "[in] aformat=sample_rates=%d:sample_fmts=%s:channel_layouts=%s "
-        "[aformat_out]; ",
+    SwrContext* swr = nullptr;
+    auto        ret = swr_alloc_set_opts2(
+        &swr,
+        &dctx->ch_layout,
+        dctx->sample_fmt,
         dctx->sample_rate,
-        av_get_sample_fmt_name(dctx->sample_fmt),
-        dest_ch_desc);
-    std::string asetnsamples_descr = format_string(
-        "[aformat_out] asetnsamples=n=%d [asetnsamples_out]; ",
-        dctx->frame_size);
-    // generate timestamps by counting samples
-    std::string asetpts_descr =
-        "[asetnsamples_out] asetpts=N/SR/TB [asetpts_out]; ";
-    std::string sink = "[asetpts_out] abuffersink";
-    auto        filters_descr =
-        input + aformat_descr + asetnsamples_descr + asetpts_descr + sink;
-
-    AVFilterInOut* unlinked_inputs  = nullptr;
-    AVFilterInOut* unlinked_outputs = nullptr;
-    if ((ret = avfilter_graph_parse2(
-             graph,
-             filters_descr.c_str(),
-             &unlinked_inputs,
-             &unlinked_outputs)) < 0)
+        &sctx->ch_layout,
+        sctx->sample_fmt,
+        sctx->sample_rate,
+        0,
+        nullptr);
+    rd.swr.reset(swr);
+    if (ret < 0)
+        return ret;
+    if (ret = swr_init(swr); ret < 0)
         return ret;
 
-    if (ret = avfilter_graph_config(graph, nullptr); ret < 0) {
-        logError(
-            "resample: invalid filter graph: src: %s err:%d, %s",
-            super.iargs.name,
-            ret,
-            ffmpeg_make_error_string(ret));
-        logTrace("filter graph dot description:\n %s", get_digraph(graph));
-    }
-
-    avfilter_inout_free(&unlinked_inputs);
-    avfilter_inout_free(&unlinked_outputs);
+    rd.fifo.reset(av_audio_fifo_alloc(
+        dctx->sample_fmt,
+        dctx->ch_layout.nb_channels,
+        std::max(dctx->frame_size, 1) * 2));
+    if (!rd.fifo)
+        return AVERROR(ENOMEM);
+    return 0;
+}
 
-    for (unsigned int i = 0; i < graph->nb_filters; ++i) {
-        auto& f = graph->filters[i];
-        if (std::string{f->filter->name} == "abuffer")
-            fd.buffersrc_ctx = avfilter_graph_get_filter(graph, f->name);
-        else if (std::string{f->filter->name} == "abuffersink")
-            fd.buffersink_ctx = avfilter_graph_get_filter(graph, f->name);
-    }
+// grows conversion buffer for <nb_samples>, it's kept between frames
+int
+resampler::impl::reserve(resample_data& rd, int nb_samples) {
+    if (nb_samples <= rd.capacity)
+        return 0;
+    auto* dctx = rd.config.dest_ctx;
+    auto* c    = rd.converted.get();
+    av_frame_unref(c);
+    c->format     = dctx->sample_fmt;
+    c->nb_samples = nb_samples;
+    if (auto ret = av_channel_layout_copy(&c->ch_layout, &dctx->ch_layout);
+        ret < 0)
+        return ret;
+    if (auto ret = av_frame_get_buffer(c, 0); ret < 0)
+        return ret;
+    rd.capacity = nb_samples;
+    return 0;
+}
 
-    return ret;
+// converts <src> samples into fifo, null <src> drains samples delayed in
+// swresample
+int
+resampler::impl::convert(resample_data& rd, const AVFrame* src) {
+    auto in_samples = src ? src->nb_samples : 0;
+    auto out_count  = swr_get_out_samples(rd.swr.get(), in_samples);
+    if (out_count <= 0)
+        return out_count;
+    if (auto ret = reserve(rd, out_count); ret < 0)
+        return ret;
+    auto* c = rd.converted.get();
+    auto  n = swr_convert(
+        rd.swr.get(),
+        c->extended_data,
+        out_count,
+        src ? const_cast<const uint8_t**>(src->extended_data) : nullptr,
+        in_samples);
+    if (n <= 0)
+        return n;
+    return av_audio_fifo_write(
+        rd.fifo.get(), reinterpret_cast<void**>(c->extended_data), n);
 }
 
 std::list<frame>
 resampler::impl::make_frames(
     const AVFrame* src, const resample_config& config) {
-    if (filters.find(config) == filters.cend()) {
-        filters.insert({config, filter_data{}});
-        filters[config].config = config;
-    }
-    auto& fd = filters[config];
-
-    if (!fd.buffersink_ctx) {
-        if (auto ec = init_filters(fd); ec < 0) {
+    auto [it, added] = resamples.try_emplace(config);
+    auto& rd         = it->second;
+    if (added) {
+        rd.config = config;
+        if (auto ret = init_resample(rd); ret < 0) {
             logError(
-                "resample: failed to initialize filters: src: %s err:%d",
+                "resample: failed to initialize resampler: src: %s err:%d, %s",
                 super.iargs.name,
-                ec);
+                ret,
+                ffmpeg_make_error_string(ret));
+            resamples.erase(it);
             return {};
         }
     }
 
-    fd.tt.start();
+    rd.tt.start();
 
-    /* push source frame into the filtergraph */
-    if (auto ret = av_buffersrc_add_frame_flags(
-            fd.buffersrc_ctx,
-            const_cast<AVFrame*>(src),
-            AV_BUFFERSRC_FLAG_PUSH | AV_BUFFERSRC_FLAG_KEEP_REF);
-        ret < 0) {
+    if (rd.next_pts == AV_NOPTS_VALUE)
+        rd.next_pts = src->pts == AV_NOPTS_VALUE
+                        ? 0
+                        : av_rescale_q(
+                              src->pts,
+                              src->time_base,
+                              {1, config.dest_ctx->sample_rate});
+    if (auto ret = convert(rd, src); ret < 0) {
         logError(
-            "resample: failed to initialize filters: src: %s err:%d, %s",
+            "resample: failed to convert samples: src: %s err:%d, %s",
             super.iargs.name,
             ret,
             ffmpeg_make_error_string(ret));
         return {};
     }
 
-    /* pull filtered frames from the filtergraph */
     std::list<frame> frames;
-    int              ret = 0;
-    while (ret >= 0) {
-        frame frm;
-        ret = av_buffersink_get_frame(fd.buffersink_ctx, frm.get());
-        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
-            break;
+    receive_frames(rd, false, frames);
+    return frames;
+}
 
-        if (fd.first_pts <= 0)
-            fd.first_pts = src->pts;
-        frm.get()->pts += fd.first_pts;
-        frm.get()->duration  = frm.get()->nb_samples;
-        frm.get()->time_base = av_buffersink_get_time_base(fd.buffersink_ctx);
+// reads frames of encoder frame size from fifo, timestamps are made by
+// counting samples. <last> pads remaining samples with silence
+void
+resampler::impl::receive_frames(
+    resample_data& rd, bool last, std::list<frame>& frames) {
+    auto* dctx = rd.config.dest_ctx;
+    auto* fifo = rd.fifo.get();
+    while (av_audio_fifo_size(fifo) > 0) {
+        auto available = av_audio_fifo_size(fifo);
+        // encoders without a frame size take any number of samples
+        auto size = dctx->frame_size > 0 ? dctx->frame_size : available;
+        if (available < size && !last)
+            break;
 
-        if (ret >= 0)
-            frames.emplace_back(std::move(frm));
+        frame frm;
+        auto* f       = frm.get();
+        f->format     = dctx->sample_fmt;
+        f->nb_samples = size;
+        f->sample_rate = dctx->sample_rate;
+        if (av_channel_layout_copy(&f->ch_layout, &dctx->ch_layout) < 0 ||
+            av_frame_get_buffer(f, 0) < 0)
+            break;
+        auto n = av_audio_fifo_read(
+            fifo, reinterpret_cast<void**>(f->extended_data), size);
+        if (n <= 0)
+            break;
+        if (n < size)
+            av_samples_set_silence(
+                f->extended_data,
+                n,
+                size - n,
+                f->ch_layout.nb_channels,
+                dctx->sample_fmt);
+
+        f->pts       = rd.next_pts;
+        f->duration  = size;
+        f->time_base = AVRational{1, dctx->sample_rate};
+        rd.next_pts += size;
+        frames.emplace_back(std::move(frm));
     }
-
-    return frames;
 }
 
 resampler::resampler(const source_data& s) : pimpl{std::make_unique<impl>(s)} {}
@@ -236,9 +267,41 @@ resampler::make_frames(
 
 void
 resampler::prune() {
-    for (auto it = pimpl->filters.begin(); it != pimpl->filters.end();)
+    for (auto it = pimpl->resamples.begin(); it != pimpl->resamples.end();)
         if (it->second.tt.seconds() > 5)
-            it = pimpl->filters.erase(it);
+            it = pimpl->resamples.erase(it);
+        else
+            ++it;
+}
+
+std::list<frame>
+resampler::flush(const AVCodecContext* out_ctx) {
+    std::list<frame> frames;
+    for (auto it = pimpl->resamples.begin(); it != pimpl->resamples.end();) {
+        auto& rd = it->second;
+        if (rd.config.dest_ctx != out_ctx) {
+            ++it;
+            continue;
+        }
+        // samples delayed in swresample and the last partial frame are
+        // passed too
+        if (pimpl->convert(rd, nullptr) >= 0)
+            pimpl->receive_frames(rd, true, frames);
+        it = pimpl->resamples.erase(it);
+    }
+    return frames;
+}
+
+void
+resampler::reset() {
+    pimpl->resamples.clear();
+}
+
+void
+resampler::remove(const AVCodecContext* ctx) {
+    for (auto it = pimpl->resamples.begin(); it != pimpl->resamples.end();)
+        if (it->second.config.dest_ctx == ctx)
+            it = pimpl->resamples.erase(it);
         else
             ++it;
 }
@@ -29,6 +29,13 @@ public:
 
     /// prunes unused resamplers
     void prune();
+    /// removes resamplers to encoder context <ctx> which is being freed
+    void remove(const AVCodecContext* ctx);
+    /// drains samples buffered in resamplers to <out_ctx> as last frames
+    /// and removes them
+    std::list<frame> flush(const AVCodecContext* out_ctx);
+    /// discards buffered samples of all resamplers
+    void reset();
 
 protected:
     struct impl;
@@ -9,6 +9,12 @@
 #include "scaler.hpp"
 #include "../source_data.hpp"
 
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/opt.h>
+}
+
 struct scale_config {
     int           src_w{0};
     int           src_h{0};
@@ -30,10 +36,14 @@ namespace std {
 
 template <> struct hash<scale_config> {
     auto operator()(const scale_config& h) const {
-        return std::hash<int>{}(h.src_w) ^ std::hash<int>{}(h.src_h) ^
-               std::hash<AVPixelFormat>{}(h.src_pixel_fmt) ^
-               std::hash<int>{}(h.dest_w) ^ std::hash<int>{}(h.dest_h) ^
-               std::hash<AVPixelFormat>{}(h.dest_pixel_fmt);
+        size_t seed = 0;
+        lxstreamer::hash_combine(seed, h.src_w);
+        lxstreamer::hash_combine(seed, h.src_h);
+        lxstreamer::hash_combine(seed, h.src_pixel_fmt);
+        lxstreamer::hash_combine(seed, h.dest_w);
+        lxstreamer::hash_combine(seed, h.dest_h);
+        lxstreamer::hash_combine(seed, h.dest_pixel_fmt);
+        return seed;
     }
 };
 
@@ -41,42 +51,123 @@ template <> struct hash<scale_config> {
 
 namespace lxstreamer {
 
+namespace {
+
+constexpr const int Frame_Align = 64; // enough for simd of any cpu
+
+int
+sws_flags_of(scale_algorithm_t algorithm) {
+    switch (algorithm) {
+    case scale_algorithm_t::bilinear:
+        return SWS_BILINEAR;
+    case scale_algorithm_t::bicubic:
+        return SWS_BICUBIC;
+    case scale_algorithm_t::area:
+        return SWS_AREA;
+    case scale_algorithm_t::point:
+        return SWS_POINT;
+    case scale_algorithm_t::lanczos:
+        return SWS_LANCZOS;
+    default:
+        return SWS_FAST_BILINEAR;
+    }
+}
+
+} // namespace
+
 struct scaler::impl {
+    struct scale_t {
+        SwsContext*   context{nullptr};
+        AVBufferPool* pool{nullptr}; // destination buffers
+    };
 
-    const source_data&                            super;
-    std::unordered_map<scale_config, SwsContext*> scales;
+    const source_data&                        super;
+    std::unordered_map<scale_config, scale_t> scales;
 
     explicit impl(const source_data& sup) : super{sup} {}
 
-    ~impl() {}
+    ~impl() {
+        // pools are freed when their last buffer is released
+        for (auto& [config, s] : scales) {
+            sws_freeContext(s.context);
+            av_buffer_pool_uninit(&s.pool);
+        }
+    }
+
+    // slice threads of a scale, one per cpu source is pinned to by default.
+    // 0 makes swscale use all cores for each scale, so it's never passed
+    int threads() const {
+        if (super.iargs.scale_threads > 0)
+            return static_cast<int>(super.iargs.scale_threads);
+        return std::max(1, static_cast<int>(super.pinned_cpus.size()));
+    }
 
     int initialize_scale(const scale_config& config) {
         if (auto it = scales.find(config); it != scales.cend())
             return 0;
 
-        SwsContext* context;
-        context = sws_getContext(
-            config.src_w,
-            config.src_h,
-            config.src_pixel_fmt,
-            config.dest_w,
-            config.dest_h,
-            config.dest_pixel_fmt,
-            SWS_FAST_BILINEAR,
-            nullptr,
-            nullptr,
-            nullptr);
+        auto* context = sws_alloc_context();
         if (!context) {
             logError(
                 "scaler: failed not allocate scale context: src: %s",
                 super.iargs.name);
+            return AVERROR(ENOMEM);
+        }
+        av_opt_set_int(context, "srcw", config.src_w, 0);
+        av_opt_set_int(context, "srch", config.src_h, 0);
+        av_opt_set_int(context, "src_format", config.src_pixel_fmt, 0);
+        av_opt_set_int(context, "dstw", config.dest_w, 0);
+        av_opt_set_int(context, "dsth", config.dest_h, 0);
+        av_opt_set_int(context, "dst_format", config.dest_pixel_fmt, 0);
+        av_opt_set_int(
+            context,
+            "sws_flags",
+            sws_flags_of(super.iargs.scale_algorithm),
+            0);
+        av_opt_set_int(context, "threads", threads(), 0);
+        if (auto ret = sws_init_context(context, nullptr, nullptr); ret < 0) {
+            logError(
+                "scaler: failed to initialize scale context: src: %s err:%d, "
+                "%s",
+                super.iargs.name,
+                ret,
+                ffmpeg_make_error_string(ret));
+            sws_freeContext(context);
             return AVERROR_INVALIDDATA;
         }
 
-        scales[config] = context;
+        auto size = av_image_get_buffer_size(
+            config.dest_pixel_fmt, config.dest_w, config.dest_h, Frame_Align);
+        auto* pool =
+            size > 0 ? av_buffer_pool_init(size, av_buffer_alloc) : nullptr;
+        if (!pool) {
+            logError(
+                "scaler: failed to allocate frame pool: src: %s",
+                super.iargs.name);
+            sws_freeContext(context);
+            return AVERROR(ENOMEM);
+        }
+
+        scales[config] = {context, pool};
 
         return 0;
     }
+
+    // attaches a pooled buffer to frame <r> for scale <config>
+    int get_buffer(const scale_config& config, AVFrame* r) {
+        r->buf[0] = av_buffer_pool_get(scales[config].pool);
+        if (!r->buf[0])
+            return AVERROR(ENOMEM);
+        auto ret = av_image_fill_arrays(
+            r->data,
+            r->linesize,
+            r->buf[0]->data,
+            config.dest_pixel_fmt,
+            config.dest_w,
+            config.dest_h,
+            Frame_Align);
+        return ret < 0 ? ret : 0;
+    }
 };
 
 scaler::scaler(const source_data& s) : pimpl{std::make_unique<impl>(s)} {}
@@ -85,20 +176,22 @@ scaler::~scaler() {}
 
 int
 scaler::perform_scale(
-    const AVFrame* frm, int width, int height, frame& result) {
+    const AVFrame* frm,
+    int            width,
+    int            height,
+    AVPixelFormat  format,
+    frame&         result) {
     if (height % 2 == 1) // check even
         --height;
     auto dest_w =
         width == -1 ? calc_width(frm->width, frm->height, height) : width;
-    auto dest_format =
-        pimpl->super.is_webcam ? AV_PIX_FMT_YUV420P : frm->format;
     scale_config config{
         frm->width,
         frm->height,
         AVPixelFormat(frm->format),
         dest_w,
         height,
-        AVPixelFormat(dest_format)};
+        format};
     if (auto it = pimpl->scales.find(config); it == pimpl->scales.cend())
         if (auto ret = pimpl->initialize_scale(config); ret != 0)
             return ret;
@@ -108,7 +201,7 @@ scaler::perform_scale(
     r->width  = dest_w;
     r->height = config.dest_h;
     r->format = config.dest_pixel_fmt;
-    auto ret  = av_frame_get_buffer(r, 0);
+    auto ret  = pimpl->get_buffer(config, r);
     if (ret < 0) {
         logError(
             "scaler: failed to allocate frame for scaling: src: %s err:%d, %s",
@@ -119,19 +212,10 @@ scaler::perform_scale(
     }
 
     av_frame_copy_props(r, frm);
-    r->width  = dest_w;
-    r->height = config.dest_h;
 
-    ret = sws_scale(
-        pimpl->scales[config],
-        frm->data,
-        frm->linesize,
-        0,
-        config.src_h,
-        r->data,
-        r->linesize);
-
-    if (ret == 0) {
+    // slices are scaled in parallel by threads of context
+    ret = sws_scale_frame(pimpl->scales[config].context, r, frm);
+    if (ret < 0) {
         logError(
             "scaler: failed to scale: src: %s err:%d, %s",
             pimpl->super.iargs.name,
@@ -24,7 +24,14 @@ public:
     explicit scaler(const source_data&);
     ~scaler();
 
-    int perform_scale(const AVFrame* frm, int width, int height, frame& result);
+    /// scales and converts <frm> to <format> in a single pass, <width> of -1
+    /// keeps aspect ratio of <frm>
+    int perform_scale(
+        const AVFrame* frm,
+        int            width,
+        int            height,
+        AVPixelFormat  format,
+        frame&         result);
 
 protected:
     struct impl;
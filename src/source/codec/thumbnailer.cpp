@@ -0,0 +1,197 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#include "thumbnailer.hpp"
+#include "../source_data.hpp"
+#include "utils.hpp"
+
+#include <atomic>
+#include <mutex>
+
+namespace lxstreamer {
+
+namespace {
+
+constexpr const int Jpeg_Quality = 5; // 2 to 31, lower is better
+
+} // namespace
+
+struct thumbnailer::impl {
+    source_data&                      super;
+    unique_ptr<AVCodecContext>        dec_ctx{nullptr};
+    unique_ptr<AVCodecContext>        enc_ctx{nullptr};
+    std::atomic<int64_t>              made_time{0}; // steady ms, 0 if none
+    std::atomic_bool                  requested{false};
+    std::mutex                        mutex;
+    std::shared_ptr<const snapshot_t> last; // guarded by mutex
+
+    explicit impl(source_data& sup) : super{sup} {}
+
+    ~impl() {}
+
+    int open_decoder() {
+        const auto* stream = super.demux_data.video_stream.stream;
+        if (!stream)
+            return AVERROR_STREAM_NOT_FOUND;
+        auto dec = avcodec_find_decoder(stream->codecpar->codec_id);
+        if (!dec)
+            return AVERROR_DECODER_NOT_FOUND;
+        dec_ctx.reset(avcodec_alloc_context3(dec));
+        if (!dec_ctx)
+            return AVERROR(ENOMEM);
+        auto ret = avcodec_parameters_to_context(
+            dec_ctx.get(), stream->codecpar);
+        if (ret < 0)
+            return ret;
+        // decoded frames are thumbnails only at key frames
+        dec_ctx->skip_frame   = AVDISCARD_NONKEY;
+        dec_ctx->thread_count = 1;
+        return avcodec_open2(dec_ctx.get(), dec, nullptr);
+    }
+
+    int open_encoder(int width, int height) {
+        auto enc = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+        if (!enc)
+            return AVERROR_ENCODER_NOT_FOUND;
+        enc_ctx.reset(avcodec_alloc_context3(enc));
+        if (!enc_ctx)
+            return AVERROR(ENOMEM);
+        enc_ctx->width          = width;
+        enc_ctx->height         = height;
+        enc_ctx->pix_fmt        = AV_PIX_FMT_YUVJ420P;
+        enc_ctx->time_base      = AVRational{1, 25};
+        enc_ctx->global_quality = FF_QP2LAMBDA * Jpeg_Quality;
+        enc_ctx->flags |= AV_CODEC_FLAG_QSCALE;
+        return avcodec_open2(enc_ctx.get(), enc, nullptr);
+    }
+
+    // decodes key frame <pkt> alone, decoder is drained so the frame isn't
+    // held for reordering
+    int decode(const AVPacket* pkt, frame& result) {
+        if (!dec_ctx)
+            if (auto ret = open_decoder(); ret < 0) {
+                dec_ctx.reset();
+                return ret;
+            }
+        auto ret = avcodec_send_packet(dec_ctx.get(), pkt);
+        if (ret >= 0)
+            ret = avcodec_send_packet(dec_ctx.get(), nullptr);
+        bool decoded = false;
+        while (ret >= 0) {
+            frame frm;
+            ret = avcodec_receive_frame(dec_ctx.get(), frm.get());
+            if (ret >= 0) {
+                av_frame_unref(result.get());
+                av_frame_move_ref(result.get(), frm.get());
+                decoded = true;
+            }
+        }
+        avcodec_flush_buffers(dec_ctx.get());
+        if (decoded)
+            return 0;
+        return ret == AVERROR_EOF ? AVERROR(EAGAIN) : ret;
+    }
+
+    int encode(AVFrame* frm, std::string& image) {
+        if (!enc_ctx || enc_ctx->width != frm->width ||
+            enc_ctx->height != frm->height)
+            if (auto ret = open_encoder(frm->width, frm->height); ret < 0) {
+                enc_ctx.reset();
+                return ret;
+            }
+        frm->quality   = enc_ctx->global_quality;
+        frm->pict_type = AV_PICTURE_TYPE_NONE;
+        auto ret       = avcodec_send_frame(enc_ctx.get(), frm);
+        if (ret < 0)
+            return ret;
+        packet pkt;
+        ret = avcodec_receive_packet(enc_ctx.get(), pkt.get());
+        if (ret < 0)
+            return ret;
+        image.assign(
+            reinterpret_cast<const char*>(pkt.get()->data), pkt.get()->size);
+        return 0;
+    }
+};
+
+thumbnailer::thumbnailer(source_data& s) : pimpl{std::make_unique<impl>(s)} {}
+
+thumbnailer::~thumbnailer() {}
+
+bool
+thumbnailer::is_due() const {
+    const auto& d = *pimpl;
+    // called from http threads too
+    auto interval = static_cast<int64_t>(d.super.iargs.thumbnail_interval);
+    if (d.requested)
+        return true;
+    if (interval <= 0)
+        return false;
+    auto made = d.made_time.load();
+    return made == 0 || steady_time_ms() - made >= interval * 1000;
+}
+
+int
+thumbnailer::make(const AVPacket* pkt) {
+    auto& d = *pimpl;
+    // a failed key frame is retried on next interval
+    d.made_time = steady_time_ms();
+
+    frame decoded;
+    auto  ret = d.decode(pkt, decoded);
+    if (ret < 0) {
+        if (ret != AVERROR(EAGAIN))
+            logWarn(
+                "thumbnailer: failed to decode key frame: src: %s err:%d, %s",
+                d.super.iargs.name,
+                ret,
+                ffmpeg_make_error_string(ret));
+        return ret;
+    }
+    auto height = d.super.iargs.thumbnail_height;
+    if (height <= 0 || height > decoded.get()->height)
+        height = decoded.get()->height;
+    frame scaled;
+    ret = d.super.iscaler.perform_scale(
+        decoded.get(), -1, height, AV_PIX_FMT_YUVJ420P, scaled);
+    if (ret < 0)
+        return ret;
+
+    auto snapshot = std::make_shared<snapshot_t>();
+    ret           = d.encode(scaled.get(), snapshot->image);
+    if (ret < 0) {
+        logWarn(
+            "thumbnailer: failed to encode thumbnail: src: %s err:%d, %s",
+            d.super.iargs.name,
+            ret,
+            ffmpeg_make_error_string(ret));
+        return ret;
+    }
+    snapshot->time = system_time_ms();
+    d.requested    = false;
+    std::scoped_lock lock{d.mutex};
+    d.last = std::move(snapshot);
+    return 0;
+}
+
+std::shared_ptr<const snapshot_t>
+thumbnailer::latest(int64_t max_age) const {
+    std::scoped_lock lock{pimpl->mutex};
+    if (!pimpl->last || system_time_ms() - pimpl->last->time > max_age * 1000)
+        pimpl->requested = true;
+    return pimpl->last;
+}
+
+void
+thumbnailer::reset() {
+    pimpl->dec_ctx.reset();
+    pimpl->enc_ctx.reset();
+    pimpl->made_time = 0;
+}
+
+} // namespace lxstreamer
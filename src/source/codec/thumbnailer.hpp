@@ -0,0 +1,47 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#ifndef THUMBNAILER_HPP
+#define THUMBNAILER_HPP
+
+#include "common_types.hpp"
+#include "ffmpeg_types.hpp"
+
+#include <memory>
+
+namespace lxstreamer {
+struct source_data;
+
+/// makes small jpeg thumbnails of key frames of a source for snapshots. it
+/// has its own decoder which only decodes key frames, so a thumbnail costs
+/// decoding one frame instead of the whole stream
+class thumbnailer final
+{
+public:
+    explicit thumbnailer(source_data&);
+    ~thumbnailer();
+
+    /// returns if a thumbnail should be made of next key frame, for
+    /// thumbnail interval of source or a pending request
+    bool is_due() const;
+    /// makes a thumbnail of key frame packet <pkt> of video stream
+    int make(const AVPacket* pkt);
+    /// returns latest thumbnail or null if none is made yet, requests a new
+    /// one if it's older than <max_age> seconds. thread safe
+    std::shared_ptr<const snapshot_t> latest(int64_t max_age) const;
+    /// closes codecs, streams of next connection may differ
+    void reset();
+
+protected:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+} // namespace lxstreamer
+
+#endif // THUMBNAILER_HPP
@@ -9,16 +9,21 @@
 #include "transcoder.hpp"
 #include "../source_data.hpp"
 
+#include <algorithm>
+#include <optional>
+#include <vector>
+
 namespace lxstreamer {
 
 struct transcoder::impl {
+    using encoded_t = std::optional<std::list<packet_ref>>;
 
-    source_data&                                          super;
-    const AVPacket*                                       ipacket{nullptr};
-    const AVFrame*                                        iframe{nullptr};
-    std::list<packet_ref>                                 unchanged;
-    std::list<frame_ref>                                  frames;
-    std::unordered_map<encoding_t, std::list<packet_ref>> packets;
+    source_data&           super;
+    const AVPacket*        ipacket{nullptr};
+    const AVFrame*         iframe{nullptr};
+    std::list<packet_ref>  unchanged;
+    std::list<frame_ref>   frames;
+    std::vector<encoded_t> packets; // by encoding id
     enum class packet_type { video = 0, audio = 1 } type{packet_type::video};
 
     explicit impl(source_data& sup, const AVPacket* pkt, const AVFrame* frm)
@@ -29,51 +34,97 @@ struct transcoder::impl {
                 super.demux_data.audio_stream.stream_idx)
                 type = packet_type::audio;
         }
-        if (frm)
+        if (frm) {
             frames.emplace_back(frm);
+            if (!pkt && frm->nb_samples > 0)
+                type = packet_type::audio;
+        }
     }
 
     ~impl() {}
 
-    inline void encode(const encoding_t& config) {
-        if (packets.find(config) != packets.cend())
-            return;
-        else
-            packets.insert(std::make_pair<encoding_t, std::list<packet_ref>>(
-                encoding_t{config}, {}));
+    // frames to be encoded by <id>, scaled or resampled if needed
+    std::list<frame_ref> input_frames(encoding_id id) {
+        std::list<frame_ref> inputs;
         for (const auto& f : frames) {
             if (type == packet_type::video) {
-                if (config.height < f->height ||
-                    super.is_webcam) { // scale and encode
+                // frames over frame rate of encoding are dropped first
+                if (!super.iencoder.take_frame(id, f.get()))
+                    continue;
+                // size and pixel format are converted in one pass, frames
+                // which encoder takes as they are skip it
+                const auto* ctx = super.iencoder.context(id);
+                if (ctx &&
+                    (f->width != ctx->width || f->height != ctx->height ||
+                     f->format != ctx->pix_fmt)) {
                     frame frm;
-                    super.iscaler.perform_scale(
-                        f.get(), -1, config.height, frm);
-                    super.iencoder.encode_packets(
-                        config, frm.get(), packets[config]);
+                    if (super.iscaler.perform_scale(
+                            f.get(),
+                            ctx->width,
+                            ctx->height,
+                            ctx->pix_fmt,
+                            frm) == 0)
+                        inputs.emplace_back(frm.get());
                 } else
-                    super.iencoder.encode_packets(
-                        config, f.get(), packets[config]);
+                    inputs.emplace_back(f.get());
             } else {
                 for (const auto& f : super.iresampler.make_frames(
                          f.get(),
                          super.idecoder.audio_context(),
-                         super.iencoder.context(config)))
-                    super.iencoder.encode_packets(
-                        config, f.get(), packets[config]);
+                         super.iencoder.context(id)))
+                    inputs.emplace_back(f.get());
             }
         }
+        return inputs;
     }
 
-    const std::list<packet_ref>& make_packets(const encoding_t& config) {
-        if ((is_video(config) && (iframe || type == packet_type::video)) ||
-            (is_audio(config) && type == packet_type::audio)) {
-            if (frames.empty())
-                super.idecoder.decode_frames(ipacket, frames);
-            encode(config);
-            return packets[config];
-        } else {
-            return unchanged;
+    bool is_encoded(encoding_id id) const {
+        return id < packets.size() && packets[id];
+    }
+
+    bool is_of_type(const encoding_t& config) const {
+        return (is_video(config) && type == packet_type::video) ||
+               (is_audio(config) && type == packet_type::audio);
+    }
+
+    void encode(const std::vector<encoding_id>& ids) {
+        std::vector<encoding_id> todo;
+        for (auto id : ids)
+            if (!is_encoded(id) && is_of_type(super.iencoder.config(id)) &&
+                std::find(todo.cbegin(), todo.cend(), id) == todo.cend())
+                todo.push_back(id);
+        if (todo.empty())
+            return;
+        if (frames.empty())
+            super.idecoder.decode_frames(ipacket, frames);
+        packets.resize(std::max(
+            packets.size(), *std::max_element(todo.cbegin(), todo.cend()) + 1));
+
+        // scaler and resampler are not shared between threads, so inputs
+        // are made here and only encoders run in parallel
+        std::vector<std::list<frame_ref>> inputs;
+        for (auto id : todo) {
+            inputs.emplace_back(input_frames(id));
+            packets[id].emplace();
         }
+        auto run = [this, &todo, &inputs](size_t i) {
+            auto& out = *packets[todo[i]];
+            for (const auto& f : inputs[i])
+                super.iencoder.encode_packets(todo[i], f.get(), out);
+        };
+        // audio encoders are too cheap for a thread
+        if (type == packet_type::video && todo.size() > 1)
+            super.encode_workers.run(todo.size(), run);
+        else
+            for (size_t i = 0; i < todo.size(); ++i)
+                run(i);
+    }
+
+    const std::list<packet_ref>& make_packets(encoding_id id) {
+        if (!is_of_type(super.iencoder.config(id)))
+            return unchanged;
+        encode({id});
+        return *packets[id];
     }
 };
 
@@ -82,9 +133,14 @@ transcoder::transcoder(source_data& s, const AVPacket* p, const AVFrame* f)
 
 transcoder::~transcoder() {}
 
+void
+transcoder::encode(const std::vector<encoding_id>& ids) {
+    pimpl->encode(ids);
+}
+
 const std::list<packet_ref>&
-transcoder::make_packets(const encoding_t& config) {
-    return pimpl->make_packets(config);
+transcoder::make_packets(encoding_id id) {
+    return pimpl->make_packets(id);
 }
 
 std::list<frame_ref>&
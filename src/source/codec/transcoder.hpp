@@ -9,10 +9,12 @@
 #ifndef TRANSCODER_HPP
 #define TRANSCODER_HPP
 
+#include "encoder.hpp"
 #include "ffmpeg_types.hpp"
 
 #include <list>
 #include <memory>
+#include <vector>
 
 namespace lxstreamer {
 struct source_data;
@@ -27,7 +29,12 @@ public:
         source_data&, const AVPacket*, const AVFrame* = nullptr);
     ~transcoder();
 
-    const std::list<packet_ref>& make_packets(const encoding_t& config);
+    /// encodes the packet once for each of encodings <ids> interned by
+    /// encoder of source, different video encoders run in parallel
+    void encode(const std::vector<encoding_id>& ids);
+    /// returns packets of encoding <id>, encodes them if they are not yet,
+    /// or returns the packet itself if it's not of the type of the encoding
+    const std::list<packet_ref>& make_packets(encoding_id id);
 
     std::list<frame_ref>& frames() const;
 
@@ -15,13 +15,32 @@
 namespace lxstreamer {
 
 struct demuxer::impl {
-    source_data& super;
+    source_data&  super;
+    bool          paused{false};
+    bool          read_paused{false}; // input is not read while paused
+    elapsed_timer standby_time;
 
     explicit impl(source_data& sd) : super{sd} {}
 
     ~impl() = default;
 
     int open_stream() {
+        // opening and probing are limited to a few sources at a time
+        auto& scheduler = super.super.reconnects;
+        if (!scheduler.acquire(super.running))
+            return AVERROR_EXIT;
+        auto ret = open_input();
+        scheduler.release();
+        if (ret != 0)
+            return ret;
+
+        super.demux_data.demuxer_initialized = true;
+        super.on_open();
+
+        return 0;
+    }
+
+    int open_input() {
         if (auto ret = super.load_input(); ret != 0) {
             logError(
                 "failed to open stream: src: %s err: %d, %s",
@@ -38,10 +57,6 @@ struct demuxer::impl {
                 ffmpeg_make_error_string(ret));
             return ret;
         }
-
-        super.demux_data.demuxer_initialized = true;
-        super.on_open();
-
         return 0;
     }
 
@@ -49,7 +64,7 @@ struct demuxer::impl {
         if (super.demux_data.should_wait_to_present())
             return AVERROR(EAGAIN);
         packet pkt;
-        int    nret = av_read_frame(super.input_ctx.get(), pkt.get());
+        int    nret = super.read_packet(pkt.get());
         if (nret == 0) { // got the packet
             if (super.demux_data.on_packet(pkt.get())) {
                 super.on_packet(pkt.get());
@@ -66,6 +81,49 @@ struct demuxer::impl {
         }
         return nret;
     }
+
+    // keeps input of a source without viewers open, returns 1 if it should
+    // be closed
+    int standby() {
+        // local files are cheap to reopen
+        auto duration = super.demux_data.is_local
+                          ? int64_t{0}
+                          : static_cast<int64_t>(super.iargs.standby_duration);
+        if (!paused && duration > 0) {
+            paused = true;
+            standby_time.start();
+            // sources supporting pause (like rtsp) stop sending, others are
+            // read and their packets are discarded before any processing
+            read_paused = av_read_pause(super.input_ctx.get()) >= 0;
+            logTrace("source is in standby: src: %s", super.iargs.name);
+        }
+        if (duration == 0 || standby_time.seconds() >= duration) {
+            // a viewer may have come meanwhile
+            if (!super.on_standby_end())
+                return 0;
+            if (paused)
+                logTrace("source closed in standby: src: %s", super.iargs.name);
+            return 1;
+        }
+        if (read_paused) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{100});
+            return 0;
+        }
+        packet pkt;
+        auto   ret = super.read_packet(pkt.get());
+        if (ret == 0)
+            super.demux_data.inter_handler.on_packet();
+        return ret;
+    }
+
+    int resume() {
+        paused = false;
+        // timeout counts from now
+        super.demux_data.inter_handler.on_packet();
+        if (read_paused)
+            return av_read_play(super.input_ctx.get());
+        return 0;
+    }
 };
 
 
@@ -87,12 +145,23 @@ demuxer::run() {
         if (d.super.demux_data.is_local) {
             auto& st = d.super.demux_data.local_file.seek_time;
             if (auto time = st.load(std::memory_order_relaxed); time > -1) {
-                d.super.seek_to(time);
+                if (d.super.seek_to(time))
+                    d.super.on_seek();
                 st.store(-1);
             }
         }
-        auto       time_point = std::chrono::steady_clock::now();
-        const auto nret       = d.process_next_packet();
+        auto time_point = std::chrono::steady_clock::now();
+        auto nret       = 0;
+        if (d.super.demux_data.standby.load(std::memory_order_relaxed)) {
+            nret = d.standby();
+            if (nret > 0)
+                break; // closed
+        } else {
+            if (d.paused)
+                nret = d.resume();
+            if (nret == 0)
+                nret = d.process_next_packet();
+        }
         if (nret >= 0) {
             if (!d.super.demux_data.should_present_faster())
                 std::this_thread::sleep_until(
@@ -40,6 +40,32 @@ struct stream_data {
     }
 };
 
+/// relates media time of a stream to wall clock time, it's updated by
+/// demuxer and read by writers threads
+struct media_clock {
+    void update(int64_t media_ms) noexcept {
+        media_time.store(media_ms, std::memory_order_relaxed);
+        wall_time.store(system_time_ms(), std::memory_order_relaxed);
+    }
+
+    /// returns wall clock time in ms since epoch for media time in ms
+    int64_t to_wall(int64_t media_ms) const noexcept {
+        auto wall = wall_time.load(std::memory_order_relaxed);
+        if (wall < 0)
+            return system_time_ms();
+        return wall + (media_ms - media_time.load(std::memory_order_relaxed));
+    }
+
+    void reset() noexcept {
+        wall_time  = -1;
+        media_time = -1;
+    }
+
+private:
+    std::atomic<int64_t> wall_time{-1};
+    std::atomic<int64_t> media_time{-1};
+};
+
 struct demuxer_data {
 
     bool should_wait_to_present() const {
@@ -72,6 +98,10 @@ struct demuxer_data {
         } else
             return false; // not interested in this packet
 
+        const auto& cs = clock_stream();
+        if (pkt->stream_index == cs.stream_idx && pkt->pts != AV_NOPTS_VALUE)
+            clock.update(av_rescale_q(
+                pkt->pts, cs.stream->time_base, AVRational{1, 1000}));
         return true;
     }
 
@@ -79,14 +109,23 @@ struct demuxer_data {
         is_local = false;
         video_stream.reset();
         audio_stream.reset();
+        clock.reset();
         demuxer_initialized = false;
+        standby             = false;
+    }
+
+    /// stream which clock follows, video if exists
+    const stream_data& clock_stream() const {
+        return video_stream.stream_idx >= 0 ? video_stream : audio_stream;
     }
 
     interrupt_handler inter_handler;
     bool              is_local = false;
     stream_data       video_stream;
     stream_data       audio_stream;
+    media_clock       clock;
     std::atomic_bool  demuxer_initialized = false;
+    std::atomic_bool  standby             = false; // connected but paused
 
     struct local_file_data {
         std::atomic<int64_t>      seek_time{-1};
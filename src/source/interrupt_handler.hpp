@@ -23,6 +23,7 @@ struct interrupt_handler {
         context->interrupt_callback.callback = &interrupt_handler::callback;
         context->interrupt_callback.opaque   = this;
         interrupt_count                      = 0;
+        elapsed.start();
     }
 
     void set_timeout(std::chrono::seconds seconds) noexcept {
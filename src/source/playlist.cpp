@@ -0,0 +1,325 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#include "playlist.hpp"
+#include "ffmpeg_types.hpp"
+#include "write/record_index.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <vector>
+
+namespace lxstreamer {
+
+namespace {
+
+constexpr const char* Playlist_Scheme = "recording://";
+
+// catalog times of a file, they are used to select files of range and to
+// map seeks. timestamps are made from media time of read packets instead
+struct chunk_t {
+    std::string path;
+    int64_t     start_time{0}; // ms since epoch
+    int64_t     offset{0};     // position in playlist in AV_TIME_BASE
+    int64_t     duration{0};   // AV_TIME_BASE
+};
+
+unique_ptr<AVFormatContext>
+open_chunk(const std::string& path) {
+    AVFormatContext* ctx = nullptr;
+    if (avformat_open_input(&ctx, path.data(), nullptr, nullptr) != 0)
+        return nullptr;
+    unique_ptr<AVFormatContext> result{ctx};
+    if (avformat_find_stream_info(ctx, nullptr) < 0)
+        return nullptr;
+    return result;
+}
+
+int64_t
+start_of(const AVFormatContext* ctx) {
+    return ctx->start_time != AV_NOPTS_VALUE ? ctx->start_time : 0;
+}
+
+} // namespace
+
+struct playlist::impl {
+    std::vector<chunk_t>                     chunks;
+    int64_t                                  from{0};
+    int64_t                                  to{0};
+    AVFormatContext*                         layout{nullptr};
+    int                                      video_idx{-1};
+    int                                      audio_idx{-1};
+    unique_ptr<AVFormatContext>              current;
+    size_t                                   current_idx{0};
+    std::future<unique_ptr<AVFormatContext>> next;
+    size_t                                   next_idx{0};
+    // playlist time of start of current file and end of packets read from
+    // it, in AV_TIME_BASE
+    int64_t                                  shift{0};
+    int64_t                                  media_end{0};
+
+    // opens next file in background while current one is playing
+    void prefetch(size_t idx) {
+        if (next.valid() && next_idx == idx)
+            return;
+        next = {};
+        if (idx >= chunks.size())
+            return;
+        next_idx = idx;
+        next     = std::async(
+            std::launch::async, open_chunk, std::cref(chunks[idx].path));
+    }
+
+    unique_ptr<AVFormatContext> take(size_t idx) {
+        if (next.valid() && next_idx == idx) {
+            auto ctx = next.get();
+            next     = {};
+            return ctx;
+        }
+        return open_chunk(chunks[idx].path);
+    }
+
+    // checks if streams of <ctx> can be played by layout streams
+    bool is_compatible(const AVFormatContext* ctx) const {
+        for (unsigned i = 0; i < layout->nb_streams; ++i) {
+            const auto* lp = layout->streams[i]->codecpar;
+            if (lp->codec_type != AVMEDIA_TYPE_VIDEO &&
+                lp->codec_type != AVMEDIA_TYPE_AUDIO)
+                continue;
+            if (av_find_best_stream(
+                    const_cast<AVFormatContext*>(ctx),
+                    lp->codec_type,
+                    -1,
+                    -1,
+                    nullptr,
+                    0) < 0)
+                continue;
+            bool found = false;
+            for (unsigned j = 0; j < ctx->nb_streams && !found; ++j)
+                found = ctx->streams[j]->codecpar->codec_id == lp->codec_id;
+            if (!found)
+                return false;
+        }
+        return true;
+    }
+
+    bool switch_to(size_t idx) {
+        for (; idx < chunks.size(); ++idx) {
+            auto ctx = take(idx);
+            if (ctx && is_compatible(ctx.get())) {
+                current     = std::move(ctx);
+                current_idx = idx;
+                prefetch(idx + 1);
+                return true;
+            }
+            logWarn("playlist: skipped unplayable file: %s", chunks[idx].path);
+        }
+        current.reset();
+        return false;
+    }
+
+    // maps packet to layout stream and playlist timeline
+    bool rebase(AVPacket* pkt) {
+        const auto* in      = current->streams[pkt->stream_index];
+        auto        type    = in->codecpar->codec_type;
+        int         out_idx = type == AVMEDIA_TYPE_VIDEO   ? video_idx
+                              : type == AVMEDIA_TYPE_AUDIO ? audio_idx
+                                                           : -1;
+        if (out_idx < 0)
+            return false;
+        const auto& out = layout->streams[out_idx]->time_base;
+        auto        ts  = av_rescale_q(
+            shift - start_of(current.get()), AV_TIME_BASE_Q, out);
+        if (pkt->pts != AV_NOPTS_VALUE)
+            pkt->pts = av_rescale_q(pkt->pts, in->time_base, out) + ts;
+        if (pkt->dts != AV_NOPTS_VALUE)
+            pkt->dts = av_rescale_q(pkt->dts, in->time_base, out) + ts;
+        if (pkt->duration > 0)
+            pkt->duration = av_rescale_q(pkt->duration, in->time_base, out);
+        pkt->stream_index = out_idx;
+        pkt->pos          = -1;
+
+        // next file starts where the last frame of this one ends, catalog
+        // end time is of the last packet and misses its duration
+        auto last = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+        if (last != AV_NOPTS_VALUE)
+            media_end = std::max(
+                media_end,
+                av_rescale_q(
+                    last + std::max<int64_t>(pkt->duration, 0),
+                    out,
+                    AV_TIME_BASE_Q));
+        return true;
+    }
+
+    // plays file <idx> from its catalog position, like after a seek
+    bool jump_to(size_t idx) {
+        if (!switch_to(idx))
+            return false;
+        shift     = chunks[current_idx].offset;
+        media_end = shift;
+        return true;
+    }
+
+    // returns if packet in playlist timeline is after end of range
+    bool is_past_end(const AVPacket* pkt) const {
+        if (pkt->pts == AV_NOPTS_VALUE)
+            return false;
+        const auto& chunk = chunks[current_idx];
+        auto        time  = av_rescale_q(
+            pkt->pts,
+            layout->streams[pkt->stream_index]->time_base,
+            AV_TIME_BASE_Q);
+        return chunk.start_time + (time - shift) / 1000 > to;
+    }
+};
+
+playlist::playlist() : pimpl{std::make_unique<impl>()} {}
+
+playlist::~playlist() {}
+
+bool
+playlist::is_playlist_url(const std::string& url) {
+    return to_lower(url).rfind(Playlist_Scheme, 0) == 0;
+}
+
+int
+playlist::load(const std::string& url, std::string& first_path) {
+    reset();
+    auto rest  = url.substr(std::strlen(Playlist_Scheme));
+    auto qpos  = rest.find('?');
+    auto name  = rest.substr(0, qpos);
+    auto query = qpos != std::string::npos ? rest.substr(qpos + 1) : "";
+    auto from  = query_value(query, "from");
+    auto to    = query_value(query, "to");
+    if (name.empty() || from.empty())
+        return AVERROR(EINVAL);
+    auto& d = *pimpl;
+    try {
+        d.from = std::stoll(from);
+        d.to   = to.empty() ? INT64_MAX : std::stoll(to);
+    } catch (const std::exception&) {
+        return AVERROR(EINVAL);
+    }
+
+    const auto& segments = find_record_segments(
+        record_directory(query_value(query, "path"), name), name, d.from, d.to);
+    int64_t offset = 0;
+    for (const auto& s : segments) {
+        chunk_t c;
+        c.path       = s.path;
+        c.start_time = s.start_time;
+        c.offset     = offset;
+        c.duration   = (s.end_time - s.start_time) * 1000;
+        offset += c.duration;
+        d.chunks.emplace_back(std::move(c));
+    }
+    if (d.chunks.empty()) {
+        logWarn("playlist: no recorded file found for: %s", url);
+        return AVERROR(ENOENT);
+    }
+    first_path = d.chunks.front().path;
+    return 0;
+}
+
+bool
+playlist::is_loaded() const {
+    return !pimpl->chunks.empty();
+}
+
+int
+playlist::open(AVFormatContext* layout) {
+    auto& d  = *pimpl;
+    d.layout = layout;
+    d.video_idx =
+        av_find_best_stream(layout, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    d.audio_idx =
+        av_find_best_stream(layout, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    if (!d.jump_to(0))
+        return AVERROR(ENOENT);
+    // start from beginning of range in first file
+    const auto& first = d.chunks[d.current_idx];
+    if (d.from > first.start_time)
+        seek((first.offset / 1000 + (d.from - first.start_time)) / 1000);
+    return 0;
+}
+
+int
+playlist::read_packet(AVPacket* pkt) {
+    auto& d = *pimpl;
+    while (d.current) {
+        int ret = av_read_frame(d.current.get(), pkt);
+        if (ret == AVERROR_EOF) {
+            if (!d.switch_to(d.current_idx + 1))
+                return AVERROR_EOF;
+            d.shift = d.media_end;
+            continue;
+        }
+        if (ret < 0)
+            return ret;
+        if (!d.rebase(pkt)) {
+            av_packet_unref(pkt);
+            continue;
+        }
+        if (d.is_past_end(pkt)) {
+            av_packet_unref(pkt);
+            return AVERROR_EOF;
+        }
+        return 0;
+    }
+    return AVERROR_EOF;
+}
+
+bool
+playlist::seek(int64_t time) {
+    auto& d = *pimpl;
+    // chunks being recorded have no duration yet
+    if (d.chunks.empty() || duration() <= 0)
+        return false;
+    auto pos = std::clamp<int64_t>(
+        av_rescale(time, AV_TIME_BASE, 1), 0, duration() - 1);
+    size_t idx = 0;
+    while (idx + 1 < d.chunks.size() &&
+           d.chunks[idx + 1].offset <= pos)
+        ++idx;
+    if (!d.current || idx != d.current_idx) {
+        if (!d.jump_to(idx))
+            return false;
+    } else
+        d.media_end = d.shift;
+    const auto& chunk = d.chunks[d.current_idx];
+    auto        ts    = start_of(d.current.get()) +
+                std::max<int64_t>(0, pos - chunk.offset);
+    return av_seek_frame(d.current.get(), -1, ts, AVSEEK_FLAG_BACKWARD) >= 0;
+}
+
+int64_t
+playlist::duration() const {
+    if (pimpl->chunks.empty())
+        return 0;
+    const auto& last = pimpl->chunks.back();
+    return last.offset + last.duration;
+}
+
+void
+playlist::reset() {
+    auto& d = *pimpl;
+    d.next  = {};
+    d.current.reset();
+    d.chunks.clear();
+    d.layout      = nullptr;
+    d.video_idx   = -1;
+    d.audio_idx   = -1;
+    d.current_idx = 0;
+    d.next_idx    = 0;
+    d.shift       = 0;
+    d.media_end   = 0;
+}
+
+} // namespace lxstreamer
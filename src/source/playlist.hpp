@@ -0,0 +1,62 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#ifndef PLAYLIST_HPP
+#define PLAYLIST_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct AVFormatContext;
+struct AVPacket;
+
+namespace lxstreamer {
+
+/// plays recorded files of a source in a time range back to back as one
+/// continuous stream. url format:
+/// recording://<source>?from=<ms>&to=<ms>[&path=<record path>]
+/// times are in ms since epoch, path is record path option of the source
+class playlist
+{
+public:
+    explicit playlist();
+    ~playlist();
+
+    /// returns if <url> is a recording url
+    static bool is_playlist_url(const std::string& url);
+
+    /// finds recorded files of <url>, sets <first_path> to the file which
+    /// should be opened as stream layout
+    int load(const std::string& url, std::string& first_path);
+
+    /// returns if a playlist is loaded
+    bool is_loaded() const;
+
+    /// starts playing, packets are mapped to streams of <layout>
+    int open(AVFormatContext* layout);
+
+    /// reads next packet with timestamps rebased to playlist timeline
+    int read_packet(AVPacket* pkt);
+
+    /// seeks to <time> in seconds from playlist start
+    bool seek(int64_t time);
+
+    /// returns total duration in AV_TIME_BASE
+    int64_t duration() const;
+
+    void reset();
+
+protected:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+} // namespace lxstreamer
+
+#endif // PLAYLIST_HPP
@@ -0,0 +1,135 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#ifndef PRE_RECORD_BUFFER_HPP
+#define PRE_RECORD_BUFFER_HPP
+
+#include "ffmpeg_types.hpp"
+
+#include <chrono>
+#include <vector>
+
+namespace lxstreamer {
+
+/// keeps the last seconds of a source in a fixed ring of packets to be
+/// written at the start of a recording. the ring always begins with a sync
+/// point (video key frame) and packets are only allocated on reserve()
+struct pre_record_buffer {
+
+    pre_record_buffer() = default;
+
+    ~pre_record_buffer() {
+        for (auto& s : slots)
+            deleter{}(s.pkt, false);
+    }
+
+    /// sets duration and grows the ring to hold at least <capacity> packets
+    void reserve(std::chrono::seconds d, size_t capacity) {
+        clear();
+        duration = std::chrono::duration_cast<std::chrono::microseconds>(d);
+        while (slots.size() < capacity)
+            slots.push_back(
+                {av_packet_alloc(), std::chrono::microseconds{0}, false});
+    }
+
+    bool enabled() const noexcept {
+        return duration.count() > 0 && !slots.empty();
+    }
+
+    size_t capacity() const noexcept {
+        return slots.size();
+    }
+
+    size_t size() const noexcept {
+        return count;
+    }
+
+    /// adds a packet received at <time>, sync points trim the ring to
+    /// whole gops covering the duration
+    void push(const AVPacket* pkt, std::chrono::microseconds time, bool sync) {
+        if (!enabled())
+            return;
+        if (sync)
+            trim(time);
+        if (count == slots.size())
+            drop_front_gop();
+        if (count == 0 && !sync)
+            return;
+        auto& s = at(count);
+        if (av_packet_ref(s.pkt, pkt) != 0)
+            return;
+        s.time = time;
+        s.sync = sync;
+        ++count;
+    }
+
+    /// calls <f> for every packet in order and empties the ring
+    template <typename F> void flush(F&& f) {
+        for (size_t i = 0; i < count; ++i)
+            f(const_cast<const AVPacket*>(at(i).pkt));
+        clear();
+    }
+
+    void clear() noexcept {
+        pop_front(count);
+        head = 0;
+    }
+
+    pre_record_buffer(const pre_record_buffer&) = delete;
+    pre_record_buffer& operator=(const pre_record_buffer&) = delete;
+
+private:
+    struct slot {
+        AVPacket*                 pkt{nullptr};
+        std::chrono::microseconds time{0};
+        bool                      sync{false};
+    };
+
+    slot& at(size_t i) noexcept {
+        return slots[(head + i) % slots.size()];
+    }
+
+    void pop_front(size_t n) noexcept {
+        for (size_t i = 0; i < n && count > 0; ++i) {
+            av_packet_unref(at(0).pkt);
+            head = (head + 1) % slots.size();
+            --count;
+        }
+    }
+
+    // keeps the newest gop which is still older than duration
+    void trim(std::chrono::microseconds now) noexcept {
+        size_t keep_from = 0;
+        for (size_t i = 1; i < count; ++i) {
+            const auto& s = at(i);
+            if (!s.sync)
+                continue;
+            if (now - s.time < duration)
+                break;
+            keep_from = i;
+        }
+        pop_front(keep_from);
+    }
+
+    // ring is full, drops the oldest gop to stay aligned to sync points
+    void drop_front_gop() noexcept {
+        size_t n = 1;
+        while (n < count && !at(n).sync)
+            ++n;
+        pop_front(n);
+    }
+
+    std::vector<slot>         slots;
+    size_t                    head{0};
+    size_t                    count{0};
+    std::chrono::microseconds duration{0};
+};
+
+} // namespace lxstreamer
+
+#endif // PRE_RECORD_BUFFER_HPP
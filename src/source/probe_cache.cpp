@@ -0,0 +1,119 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#include "probe_cache.hpp"
+#include "ffmpeg_types.hpp"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace lxstreamer {
+
+namespace {
+
+struct stream_entry {
+    unique_ptr<AVCodecParameters> par{avcodec_parameters_alloc()};
+    AVRational                    r_frame_rate{0, 1};
+    AVRational                    avg_frame_rate{0, 1};
+};
+
+bool
+is_complete(const AVCodecParameters* par) {
+    if (par->codec_type == AVMEDIA_TYPE_VIDEO)
+        return par->width > 0 && par->height > 0 && par->format >= 0;
+    if (par->codec_type == AVMEDIA_TYPE_AUDIO)
+        return par->sample_rate > 0 && par->format >= 0;
+    return true;
+}
+
+} // namespace
+
+struct probe_cache::impl {
+    using entry_t = std::vector<stream_entry>;
+
+    mutable std::mutex                       mutex;
+    std::unordered_map<std::string, entry_t> entries;
+};
+
+probe_cache::probe_cache() : pimpl{std::make_unique<impl>()} {}
+
+probe_cache::~probe_cache() {}
+
+bool
+probe_cache::is_complete(const AVFormatContext* ctx) {
+    bool found = false;
+    for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+        const auto* par = ctx->streams[i]->codecpar;
+        if (!lxstreamer::is_complete(par))
+            return false;
+        found |= par->codec_type == AVMEDIA_TYPE_VIDEO ||
+                 par->codec_type == AVMEDIA_TYPE_AUDIO;
+    }
+    return found;
+}
+
+bool
+probe_cache::matches(const std::string& url, const AVFormatContext* ctx) const {
+    std::scoped_lock lock{pimpl->mutex};
+    auto             it = pimpl->entries.find(url);
+    if (it == pimpl->entries.cend() || it->second.size() != ctx->nb_streams)
+        return false;
+    for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+        const auto* par    = ctx->streams[i]->codecpar;
+        const auto* cached = it->second[i].par.get();
+        if (par->codec_type != cached->codec_type ||
+            par->codec_id != cached->codec_id)
+            return false;
+    }
+    return true;
+}
+
+void
+probe_cache::complete(const std::string& url, AVFormatContext* ctx) const {
+    std::scoped_lock lock{pimpl->mutex};
+    auto             it = pimpl->entries.find(url);
+    if (it == pimpl->entries.cend() || it->second.size() != ctx->nb_streams)
+        return;
+    for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+        auto*       stream = ctx->streams[i];
+        const auto& cached = it->second[i];
+        if (stream->codecpar->codec_id != cached.par->codec_id)
+            continue;
+        if (!lxstreamer::is_complete(stream->codecpar))
+            avcodec_parameters_copy(stream->codecpar, cached.par.get());
+        if (stream->r_frame_rate.num == 0)
+            stream->r_frame_rate = cached.r_frame_rate;
+        if (stream->avg_frame_rate.num == 0)
+            stream->avg_frame_rate = cached.avg_frame_rate;
+    }
+}
+
+void
+probe_cache::store(const std::string& url, const AVFormatContext* ctx) {
+    impl::entry_t entry(ctx->nb_streams);
+    for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+        const auto* stream = ctx->streams[i];
+        auto&       e      = entry[i];
+        if (!e.par ||
+            avcodec_parameters_copy(e.par.get(), stream->codecpar) < 0)
+            return;
+        e.r_frame_rate   = stream->r_frame_rate;
+        e.avg_frame_rate = stream->avg_frame_rate;
+    }
+    std::scoped_lock lock{pimpl->mutex};
+    pimpl->entries[url] = std::move(entry);
+}
+
+void
+probe_cache::remove(const std::string& url) {
+    std::scoped_lock lock{pimpl->mutex};
+    pimpl->entries.erase(url);
+}
+
+} // namespace lxstreamer
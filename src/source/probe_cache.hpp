@@ -0,0 +1,51 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#ifndef PROBE_CACHE_HPP
+#define PROBE_CACHE_HPP
+
+#include <memory>
+#include <string>
+
+struct AVFormatContext;
+
+namespace lxstreamer {
+
+/// keeps stream parameters of network sources found by probing, keyed by
+/// url, so reconnecting to them needs only a short probe. thread safe
+class probe_cache
+{
+public:
+    explicit probe_cache();
+    ~probe_cache();
+
+    /// returns if all video and audio streams of <ctx> have parameters
+    /// needed for decoding and remuxing
+    static bool is_complete(const AVFormatContext* ctx);
+
+    /// returns if streams opened in <ctx> match cached layout of <url>
+    bool matches(const std::string& url, const AVFormatContext* ctx) const;
+
+    /// fills parameters of streams in <ctx> which are left incomplete by a
+    /// short probe from cache of <url>
+    void complete(const std::string& url, AVFormatContext* ctx) const;
+
+    /// caches stream parameters of <ctx> for <url>
+    void store(const std::string& url, const AVFormatContext* ctx);
+
+    /// removes cache of <url>
+    void remove(const std::string& url);
+
+protected:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+} // namespace lxstreamer
+
+#endif // PROBE_CACHE_HPP
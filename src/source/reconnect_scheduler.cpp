@@ -0,0 +1,113 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#include "reconnect_scheduler.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+
+namespace lxstreamer {
+
+namespace {
+
+constexpr const auto   Retry_Delay_Min   = std::chrono::milliseconds{2000};
+constexpr const auto   Retry_Delay_Max   = std::chrono::milliseconds{60000};
+constexpr const auto   Acquire_Interval  = std::chrono::milliseconds{100};
+constexpr const size_t Default_Max_Opens = 16;
+
+} // namespace
+
+struct reconnect_scheduler::impl {
+    using clock = std::chrono::steady_clock;
+
+    std::mutex              mutex;
+    std::condition_variable cv;
+    size_t                  max_opens{Default_Max_Opens};
+    size_t                  opens{0};
+    std::minstd_rand        random{std::random_device{}()};
+    size_t                  startup_rate{0};
+    clock::time_point       next_start{};
+};
+
+reconnect_scheduler::reconnect_scheduler()
+    : pimpl{std::make_unique<impl>()} {}
+
+reconnect_scheduler::~reconnect_scheduler() {}
+
+void
+reconnect_scheduler::set_max_opens(size_t count) {
+    {
+        std::scoped_lock lock{pimpl->mutex};
+        pimpl->max_opens = count;
+    }
+    pimpl->cv.notify_all();
+}
+
+bool
+reconnect_scheduler::acquire(const std::atomic_bool& running) {
+    std::unique_lock<std::mutex> lock{pimpl->mutex};
+    auto is_free = [&] {
+        return pimpl->max_opens == 0 || pimpl->opens < pimpl->max_opens;
+    };
+    // <running> is not signaled, so it's polled
+    while (!is_free()) {
+        if (!running.load())
+            return false;
+        pimpl->cv.wait_for(lock, Acquire_Interval);
+    }
+    ++pimpl->opens;
+    return true;
+}
+
+void
+reconnect_scheduler::release() {
+    {
+        std::scoped_lock lock{pimpl->mutex};
+        if (pimpl->opens > 0)
+            --pimpl->opens;
+    }
+    pimpl->cv.notify_one();
+}
+
+std::chrono::milliseconds
+reconnect_scheduler::retry_delay(size_t failures) {
+    auto delay = Retry_Delay_Min;
+    for (size_t i = 0; i < failures && delay < Retry_Delay_Max; ++i)
+        delay *= 2;
+    delay = std::min(delay, Retry_Delay_Max);
+    // a random delay in [delay / 2, delay] keeps sources which have failed
+    // together from retrying in lockstep
+    std::scoped_lock lock{pimpl->mutex};
+    std::uniform_int_distribution<int64_t> dist{
+        delay.count() / 2, delay.count()};
+    return std::chrono::milliseconds{dist(pimpl->random)};
+}
+
+void
+reconnect_scheduler::set_startup_rate(size_t count) {
+    std::scoped_lock lock{pimpl->mutex};
+    pimpl->startup_rate = count;
+}
+
+std::chrono::milliseconds
+reconnect_scheduler::start_delay() {
+    using namespace std::chrono;
+    std::scoped_lock lock{pimpl->mutex};
+    if (pimpl->startup_rate == 0)
+        return milliseconds{0};
+    auto now   = impl::clock::now();
+    auto start = std::max(now, pimpl->next_start);
+    pimpl->next_start =
+        start + duration_cast<impl::clock::duration>(
+                    seconds{1}) / static_cast<int64_t>(pimpl->startup_rate);
+    return duration_cast<milliseconds>(start - now);
+}
+
+} // namespace lxstreamer
@@ -0,0 +1,54 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#ifndef RECONNECT_SCHEDULER_HPP
+#define RECONNECT_SCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace lxstreamer {
+
+/// spreads connection attempts of sources over time. retries of a source
+/// are delayed exponentially by its consecutive failures with a random
+/// jitter, and the number of sources opening and probing their inputs at
+/// the same time is limited. thread safe
+class reconnect_scheduler
+{
+public:
+    explicit reconnect_scheduler();
+    ~reconnect_scheduler();
+
+    /// sets max number of sources opening at the same time, 0 for no limit
+    void set_max_opens(size_t count);
+
+    /// waits for a free slot to open a source, returns false if <running>
+    /// is cleared meanwhile. a granted slot should be released
+    bool acquire(const std::atomic_bool& running);
+    void release();
+
+    /// returns delay before next connection attempt of a source which has
+    /// failed <failures> times in a row
+    std::chrono::milliseconds retry_delay(size_t failures);
+
+    /// sets max number of sources started per second, 0 for no limit
+    void set_startup_rate(size_t count);
+
+    /// returns delay for starting a new source, so sources started together
+    /// are spread by startup rate
+    std::chrono::milliseconds start_delay();
+
+protected:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+} // namespace lxstreamer
+
+#endif // RECONNECT_SCHEDULER_HPP
@@ -12,22 +12,53 @@
 #include "error_types.hpp"
 #include "source_data.hpp"
 #include "utils.hpp"
+#include "write/record_index.hpp"
 
+#include <algorithm>
+#include <condition_variable>
+#include <optional>
 #include <thread>
+#include <vector>
 
 namespace lxstreamer {
 
+// idle sources check if they are needed at this interval
+constexpr const auto Idle_Interval = std::chrono::milliseconds{2000};
+// a connection lasting this long resets retry backoff
+constexpr const int64_t Stable_Connection = 30 * 1000; // ms
+// snapshots of sources without thumbnail interval are made again after
+constexpr const int64_t Snapshot_Age = 5; // seconds
+
 struct source::impl : public source_data {
     std::thread              worker;
     std::unique_ptr<demuxer> idemuxer;
     elapsed_timer            run_elapsed_time;
     elapsed_timer            viewless_time;
-    std::mutex               mutex;
+    elapsed_timer            record_retry_time;
+    bool                     record_retry{false};
+    std::atomic_bool         record_restart{false}; // options are changed
+    // options of last start_recording, guarded by mutex. they're taken by
+    // source thread once recorder of old options is closed
+    record_options_t         requested_options;
+    std::condition_variable  cv;     // wakes up worker on destruction
+    source_status_t          status; // guarded by mutex
+    // viewers are started on joining while it's connected, others are
+    // pending until next connection. both are guarded by mutex
+    bool                               live{false};
+    std::list<std::unique_ptr<viewer>> pending_viewers;
 
     impl(const streamer_data& s, const source_args_t& args)
-        : source_data(s, args) {}
+        : source_data(s, args) {
+        // pre-recording and thumbnails need the stream to be always read
+        demuxing =
+            iargs.pre_record_duration > 0 || iargs.thumbnail_interval > 0;
+    }
     ~impl() {
-        running.store(false);
+        {
+            std::scoped_lock lock{mutex};
+            running.store(false);
+        }
+        cv.notify_all();
         demux_data.inter_handler.running = false;
         if (worker.joinable()) {
             try {
@@ -42,52 +73,84 @@ struct source::impl : public source_data {
         }
     };
 
-    std::error_code start_worker();
-    void            run();
+    std::error_code start_worker(std::chrono::milliseconds delay);
+    std::error_code run();
+    void            wait_to_retry(const std::error_code& ec);
     void            on_open() override;
     void            on_packet(const AVPacket*) override;
+    void            on_seek() override;
+    bool            on_standby_end() override;
 
+    void drain(bool record_only);
+    void write_encoded(encoding_id id, const std::list<packet_ref>& packets);
     void start_recording();
+    void reserve_pre_record();
+    void write_record_packets(
+        std::optional<transcoder>& tc, const AVPacket* pkt, bool is_video);
 };
 
 std::error_code
-source::impl::start_worker() {
+source::impl::start_worker(std::chrono::milliseconds delay) {
     if (!running.load() && !worker.joinable()) {
         running.store(true);
-        worker = std::thread{[this]() {
+        worker = std::thread{[this, delay]() {
+            pin_thread();
+            if (delay.count() > 0) {
+                std::unique_lock<std::mutex> lock{mutex};
+                cv.wait_for(lock, delay, [&] { return !running.load(); });
+            }
             while (running.load()) {
                 if (demuxing || recording) {
+                    std::error_code ec;
                     try {
-                        run();
+                        ec = run();
                     } catch (std::system_error& e) {
                         logFatal(
                             "source system error: src: %s err: %d, %s",
                             iargs.name,
                             e.code().value(),
                             e.what());
+                        ec = e.code();
                     } catch (std::exception& e) {
                         logFatal(
                             "source unknown error: src: %s err: %s",
                             iargs.name,
                             e.what());
+                        ec = make_err(error_t::unknown);
                     }
+                    wait_to_retry(ec);
+                } else {
+                    std::unique_lock<std::mutex> lock{mutex};
+                    cv.wait_for(lock, Idle_Interval, [&] {
+                        return !running.load() || demuxing || recording;
+                    });
                 }
-                if (running.load())
-                    std::this_thread::sleep_for(
-                        std::chrono::milliseconds{2000});
             }
         }};
     }
     return std::error_code{};
 }
 
-void
+std::error_code
 source::impl::run() {
+    {
+        std::scoped_lock lock{mutex};
+        status.state = source_state_t::connecting;
+    }
     idemuxer = std::make_unique<demuxer>(*this);
 
     run_elapsed_time.start();
 
-    idemuxer->run();
+    auto ec = idemuxer->run();
+    {
+        // viewers joining from now wait for the next connection
+        std::scoped_lock lock{mutex};
+        live = false;
+    }
+    // replaying a local file from start is not a failure
+    if (demux_data.is_local && ec == ffmpeg_make_err(AVERROR_EOF))
+        ec = std::error_code{};
+    drain(false);
 
     {
         std::scoped_lock lock{mutex};
@@ -95,8 +158,41 @@ source::impl::run() {
     }
     if (irecorder)
         irecorder.reset();
+    pre_record.clear();
+    ithumbnailer.reset();
     idemuxer.reset();
     demux_data.reset();
+    return ec;
+}
+
+void
+source::impl::wait_to_retry(const std::error_code& ec) {
+    std::unique_lock<std::mutex> lock{mutex};
+    auto                         now = system_time_ms();
+    bool ended = !ec; // stopped for having no viewer or end of file
+    bool stable = status.state == source_state_t::connected &&
+                  now - status.connected_time >= Stable_Connection;
+    status.failures = ended || stable ? 0 : status.failures + 1;
+    if (ec) {
+        status.last_error         = ec.value();
+        status.last_error_message = ec.message();
+    }
+    if (!demuxing && !recording) {
+        status.state = source_state_t::stopped;
+        return;
+    }
+
+    auto delay = ended ? Idle_Interval
+                       : super.reconnects.retry_delay(status.failures);
+    status.state      = source_state_t::waiting;
+    status.retry_time = now + delay.count();
+    if (status.failures > 0)
+        logInfo(
+            "source reconnects in %d ms: src: %s failures: %d",
+            static_cast<int>(delay.count()),
+            iargs.name,
+            static_cast<int>(status.failures));
+    cv.wait_for(lock, delay, [&] { return !running.load(); });
 }
 
 void
@@ -127,8 +223,17 @@ source::impl::on_open() {
             iargs.audio_encoding.channel_layout;
     } else
         view_encoding.audio.codec = codec_t::unknown;
+    view_encoding.video_id = iencoder.intern(view_encoding.video);
+    view_encoding.audio_id = iencoder.intern(view_encoding.audio);
+
+    if (iargs.pre_record_duration > 0)
+        reserve_pre_record();
 
     std::scoped_lock lock{mutex};
+    status.state          = source_state_t::connected;
+    status.connected_time = system_time_ms();
+    live                  = true;
+    viewers.splice(viewers.end(), pending_viewers);
     for (const auto& v : viewers)
         v->start();
 }
@@ -136,25 +241,75 @@ source::impl::on_open() {
 void
 source::impl::on_packet(const AVPacket* pkt) {
     auto is_video = pkt->stream_index == demux_data.video_stream.stream_idx;
-    transcoder tc{*this, pkt};
-    if (irecorder) {
-        if (is_video || record_options.record_audio)
-            for (const auto& p : tc.make_packets(
-                     is_video ? record_encoding.video : record_encoding.audio))
-                if (auto ret = irecorder->write_packet(p.get()); ret < 0)
-                    irecorder.reset();
+    if (record_restart.exchange(false)) {
+        if (irecorder) {
+            drain(true);
+            irecorder.reset();
+        }
+        // recorder thread reads options, it's closed now
+        std::scoped_lock lock{mutex};
+        record_options = requested_options;
+    }
+    if (!recording)
+        record_retry = false;
+    else if (!irecorder &&
+             (!record_retry || record_retry_time.seconds() > 5))
+        start_recording();
+
+    if (is_video && (pkt->flags & AV_PKT_FLAG_KEY) && ithumbnailer.is_due())
+        ithumbnailer.make(pkt);
+
+    // plans distinct encodings of writers, each one is encoded once and
+    // out of the viewers lock. 0 ids are remuxed
+    encoding_id view_id   = 0;
+    encoding_id record_id = 0;
+    {
+        std::scoped_lock lock{mutex};
+        if (!viewers.empty())
+            view_id =
+                is_video ? view_encoding.video_id : view_encoding.audio_id;
+        record_id =
+            is_video ? record_encoding.video_id : record_encoding.audio_id;
+    }
+    if (!irecorder || (!is_video && !record_options.record_audio))
+        record_id = 0;
+
+    // transcoder is only made when a writer needs encoding, remux only
+    // writers share the demuxed packet
+    std::optional<transcoder> tc;
+    if (view_id != 0 || record_id != 0) {
+        tc.emplace(*this, pkt);
+        tc->encode({view_id, record_id});
     }
+    if (irecorder)
+        write_record_packets(tc, pkt, is_video);
+    else if (pre_record.enabled())
+        pre_record.push(
+            pkt,
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()),
+            is_video ? (pkt->flags & AV_PKT_FLAG_KEY) != 0
+                     : !demux_data.video_stream.stream);
 
     std::scoped_lock lock{mutex};
+    // a viewer added after planning is encoded for here
+    view_id = is_video ? view_encoding.video_id : view_encoding.audio_id;
+    const std::list<packet_ref>* packets = nullptr;
+    if (view_id != 0 && !viewers.empty()) {
+        if (!tc)
+            tc.emplace(*this, pkt);
+        packets = &tc->make_packets(view_id);
+    }
     for (auto iter = viewers.begin(); iter != viewers.end();) {
-        const auto& packets = tc.make_packets(
-            is_video ? view_encoding.video : view_encoding.audio);
         int nret = 0;
-        for (const auto& p : packets) {
-            nret = iter->get()->write_packet(p.get());
-            if (nret < 0)
-                break;
-        }
+        if (!packets)
+            nret = iter->get()->write_packet(pkt);
+        else
+            for (const auto& p : *packets) {
+                nret = iter->get()->write_packet(p.get());
+                if (nret < 0)
+                    break;
+            }
         if (nret < 0) {
             iter = viewers.erase(iter);
         } else {
@@ -163,14 +318,18 @@ source::impl::on_packet(const AVPacket* pkt) {
     }
 
     if (run_elapsed_time.seconds() > 5) {
-        if (recording && !irecorder)
-            start_recording();
-        if (!recording && irecorder)
+        if (!recording && irecorder) {
+            drain(true);
             irecorder.reset();
+        }
 
         if (viewers.empty()) {
-            if (viewless_time.seconds() > 30 && !recording) {
-                demuxing = false;
+            if (viewless_time.seconds() >
+                    static_cast<int64_t>(iargs.viewless_timeout) &&
+                !recording && !pre_record.enabled() &&
+                iargs.thumbnail_interval == 0) {
+                // demuxer closes it after standby duration
+                demux_data.standby = true;
                 logTrace(
                     "source stalled due to not having any viewer: src: %s",
                     iargs.name);
@@ -184,8 +343,150 @@ source::impl::on_packet(const AVPacket* pkt) {
     }
 }
 
+void
+source::impl::on_seek() {
+    // frames before the seek point are written, codecs start over
+    drain(false);
+}
+
+bool
+source::impl::on_standby_end() {
+    // decided along with add_viewer, so a viewer joins either before and
+    // keeps the source, or after and waits for the next connection
+    std::scoped_lock lock{mutex};
+    if (!demux_data.standby || !viewers.empty())
+        return false;
+    demux_data.standby = false;
+    demuxing           = false;
+    return true;
+}
+
+// passes frames and packets buffered in codecs to writers of their
+// encodings and resets the codecs, so nothing is lost when writers are
+// closed or the stream jumps. <record_only> drains encoders of recorder
+// which aren't shared with viewers
+void
+source::impl::drain(bool record_only) {
+    bool           viewed = false;
+    encoder_config view, record;
+    {
+        std::scoped_lock lock{mutex};
+        viewed = !viewers.empty();
+        view   = view_encoding;
+        record = record_encoding;
+    }
+    std::vector<encoding_id> ids;
+    auto                     add = [&](encoding_id id) {
+        if (id != 0 && std::find(ids.cbegin(), ids.cend(), id) == ids.cend())
+            ids.push_back(id);
+    };
+    auto is_viewed = [&](encoding_id id) {
+        return viewed && (id == view.video_id || id == view.audio_id);
+    };
+    if (irecorder)
+        for (auto id : {record.video_id, record.audio_id})
+            if (!record_only || !is_viewed(id))
+                add(id);
+    if (!record_only && viewed) {
+        add(view.video_id);
+        add(view.audio_id);
+    }
+
+    const auto& streams = {&demux_data.video_stream, &demux_data.audio_stream};
+    if (!record_only)
+        for (const auto* s : streams) {
+            if (!s->stream)
+                continue;
+            std::list<frame_ref> frames;
+            idecoder.flush(s->stream_idx, frames);
+            for (const auto& f : frames) {
+                transcoder tc{*this, nullptr, f.get()};
+                for (auto id : ids)
+                    write_encoded(id, tc.make_packets(id));
+            }
+        }
+    for (auto id : ids) {
+        std::list<packet_ref> packets;
+        if (is_audio(iencoder.config(id)))
+            for (const auto& f : iresampler.flush(iencoder.context(id)))
+                iencoder.encode_packets(id, f.get(), packets);
+        iencoder.flush(id, packets);
+        write_encoded(id, packets);
+    }
+    if (!record_only)
+        iresampler.reset();
+}
+
+void
+source::impl::write_encoded(
+    encoding_id id, const std::list<packet_ref>& packets) {
+    if (packets.empty())
+        return;
+    std::scoped_lock lock{mutex};
+    if (irecorder &&
+        (id == record_encoding.video_id ||
+         (id == record_encoding.audio_id && record_options.record_audio)))
+        for (const auto& p : packets)
+            if (irecorder->write_packet(p.get()) < 0)
+                break;
+    if (id == view_encoding.video_id || id == view_encoding.audio_id)
+        for (const auto& v : viewers)
+            for (const auto& p : packets)
+                if (v->write_packet(p.get()) < 0)
+                    break;
+}
+
+void
+source::impl::write_record_packets(
+    std::optional<transcoder>& tc, const AVPacket* pkt, bool is_video) {
+    if (!is_video && !record_options.record_audio)
+        return;
+    encoding_id id = 0;
+    {
+        std::scoped_lock lock{mutex};
+        id = is_video ? record_encoding.video_id : record_encoding.audio_id;
+    }
+    if (id == 0) {
+        if (irecorder->write_packet(pkt) < 0)
+            irecorder.reset();
+        return;
+    }
+    if (!tc)
+        tc.emplace(*this, pkt);
+    for (const auto& p : tc->make_packets(id))
+        if (auto ret = irecorder->write_packet(p.get()); ret < 0) {
+            irecorder.reset();
+            break;
+        }
+}
+
+void
+source::impl::reserve_pre_record() {
+    // estimate packets per second of video and audio streams
+    double rate = 0;
+    if (const auto* s = demux_data.video_stream.stream; s) {
+        auto fps = av_q2d(s->avg_frame_rate);
+        rate += fps > 0 ? fps : 30;
+    }
+    if (const auto* s = demux_data.audio_stream.stream; s) {
+        auto frame_size =
+            s->codecpar->frame_size > 0 ? s->codecpar->frame_size : 1024;
+        rate += s->codecpar->sample_rate > 0
+                    ? double(s->codecpar->sample_rate) / frame_size
+                    : 50;
+    }
+    // leave room for a few seconds of the gop before the duration
+    auto seconds = iargs.pre_record_duration + 5;
+    pre_record.reserve(
+        std::chrono::seconds{iargs.pre_record_duration},
+        static_cast<size_t>(seconds * rate));
+}
+
 void
 source::impl::start_recording() {
+    record_retry = true;
+    record_retry_time.start();
+
     if (is_video(record_options.video_encoding) || is_webcam) {
         auto codec       = record_options.video_encoding.codec;
         auto height      = record_options.video_encoding.height;
@@ -203,6 +504,8 @@ source::impl::start_recording() {
             demux_data.video_stream.stream->codecpar->height);
     } else
         record_encoding.video.codec = codec_t::unknown;
+    record_encoding.video_id = iencoder.intern(record_encoding.video);
+    record_encoding.audio_id = iencoder.intern(record_encoding.audio);
 
     irecorder = std::make_unique<recorder>();
     if (auto ec = irecorder->init(this); ec) {
@@ -210,6 +513,15 @@ source::impl::start_recording() {
         return;
     }
     irecorder->start();
+
+    // write pre-recorded packets before the current one
+    pre_record.flush([this](const AVPacket* p) {
+        if (!irecorder)
+            return;
+        std::optional<transcoder> tc;
+        write_record_packets(
+            tc, p, p->stream_index == demux_data.video_stream.stream_idx);
+    });
 }
 
 source::source(const streamer_data& s, const source_args_t& args)
@@ -218,8 +530,19 @@ source::source(const streamer_data& s, const source_args_t& args)
 source::~source() {}
 
 std::error_code
-source::start() {
-    return pimpl->start_worker();
+source::start(std::chrono::milliseconds delay) {
+    return pimpl->start_worker(delay);
+}
+
+void
+source::stop() {
+    {
+        std::scoped_lock lock{pimpl->mutex};
+        pimpl->running.store(false);
+        pimpl->demuxing.store(false);
+    }
+    pimpl->cv.notify_all();
+    pimpl->demux_data.inter_handler.running = false;
 }
 
 const source_args_t&
@@ -232,16 +555,42 @@ source::is_recording() const {
     return pimpl->recording.load();
 }
 
+source_status_t
+source::status() const {
+    std::scoped_lock lock{pimpl->mutex};
+    auto             status = pimpl->status;
+    if (status.state == source_state_t::connected &&
+        pimpl->demux_data.standby)
+        status.state = source_state_t::standby;
+    auto encoders         = pimpl->iencoder.stats();
+    status.encoders       = encoders.size;
+    status.encoder_opens  = encoders.opens;
+    status.encoder_reuses = encoders.reuses;
+    return status;
+}
+
 std::error_code
 source::start_recording(const record_options_t& options) {
     if (pimpl->recording)
         return make_err(error_t::already_done);
-    pimpl->record_options = options;
-    pimpl->recording      = true;
-    pimpl->demuxing       = true;
+    {
+        std::scoped_lock lock{pimpl->mutex};
+        pimpl->requested_options  = options;
+        pimpl->record_restart     = true;
+        pimpl->recording          = true;
+        pimpl->demux_data.standby = false;
+        pimpl->demuxing           = true;
+    }
+    pimpl->cv.notify_all();
     return std::error_code{};
 }
 
+record_options_t
+source::record_options() const {
+    std::scoped_lock lock{pimpl->mutex};
+    return pimpl->requested_options;
+}
+
 std::error_code
 source::stop_recording() {
     if (!pimpl->recording)
@@ -250,6 +599,18 @@ source::stop_recording() {
     return std::error_code{};
 }
 
+std::list<record_segment_t>
+source::find_recordings(int64_t from, int64_t to) const {
+    return find_record_segments(
+        record_directory(), pimpl->iargs.name, from, to);
+}
+
+std::string
+source::record_directory() const {
+    return lxstreamer::record_directory(
+        record_options().path, pimpl->iargs.name);
+}
+
 std::error_code
 source::seek(int64_t time) {
     pimpl->demux_data.local_file.seek_time.store(time);
@@ -262,15 +623,46 @@ source::set_speed(double speed) {
     return std::error_code{};
 }
 
+std::error_code
+source::snapshot(snapshot_t& snapshot) {
+    auto interval = static_cast<int64_t>(pimpl->iargs.thumbnail_interval);
+    auto latest =
+        pimpl->ithumbnailer.latest(interval > 0 ? interval : Snapshot_Age);
+    if (pimpl->ithumbnailer.is_due()) {
+        // a new one is made on next key frame, wakes up an idle source and
+        // keeps it for viewless timeout
+        {
+            std::scoped_lock lock{pimpl->mutex};
+            pimpl->viewless_time.start();
+            pimpl->demux_data.standby = false;
+            pimpl->demuxing           = true;
+        }
+        pimpl->cv.notify_all();
+    }
+    if (!latest)
+        return make_err(error_t::busy);
+    snapshot = *latest;
+    return std::error_code{};
+}
+
 std::error_code
 source::add_viewer(std::unique_ptr<viewer> v) {
     if (auto ec = v->init(pimpl.get()); ec)
         return ec;
-    std::scoped_lock lock{pimpl->mutex};
-    if (pimpl->demuxing && pimpl->demux_data.demuxer_initialized)
-        v->start();
-    pimpl->viewers.emplace_back(std::move(v));
-    pimpl->demuxing = true;
+    {
+        std::scoped_lock lock{pimpl->mutex};
+        pimpl->viewless_time.start();
+        pimpl->demux_data.standby = false;
+        // others are started when source is connected again
+        if (pimpl->demuxing && pimpl->live) {
+            v->start();
+            pimpl->viewers.emplace_back(std::move(v));
+        } else
+            pimpl->pending_viewers.emplace_back(std::move(v));
+        pimpl->demuxing = true;
+    }
+    // wakes up an idle source
+    pimpl->cv.notify_all();
     return std::error_code{};
 }
 
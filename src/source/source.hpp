@@ -11,6 +11,8 @@
 
 #include "common_types.hpp"
 
+#include <chrono>
+#include <list>
 #include <memory>
 #include <system_error>
 
@@ -23,23 +25,38 @@ struct source final {
     explicit source(const streamer_data&, const source_args_t&);
     ~source();
 
-    std::error_code start();
+    /// starts source threads after <delay>
+    std::error_code start(std::chrono::milliseconds delay = {});
+    /// stops threads of source without waiting for them
+    void stop();
 
     const source_args_t& args() const;
 
     /// returns if it's recording
     bool is_recording() const;
 
+    /// returns connection health
+    source_status_t status() const;
+
     /// starts recording with options
     std::error_code start_recording(const record_options_t& options);
+    /// returns options of current or last recording
+    record_options_t record_options() const;
     /// stops recording
     std::error_code stop_recording();
+    /// returns recorded files overlapping [from, to] in ms since epoch
+    std::list<record_segment_t> find_recordings(int64_t from, int64_t to) const;
+    /// returns directory of recorded files
+    std::string record_directory() const;
 
     /// seeks to pos for file inputs
     std::error_code seek(int64_t time);
     /// sets playback speed for file inputs
     std::error_code set_speed(double speed);
 
+    /// gets latest thumbnail of source, a new one is made if it's old
+    std::error_code snapshot(snapshot_t& snapshot);
+
     /// adds a client for streaming
     std::error_code add_viewer(std::unique_ptr<viewer> v);
 
@@ -0,0 +1,421 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#include "source_config.hpp"
+#include "error_types.hpp"
+#include "utils.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace lxstreamer {
+
+namespace {
+
+// a minimal json document, enough for config files
+struct json_value {
+    enum class type_t { null, boolean, number, string, array, object };
+
+    type_t                   type{type_t::null};
+    bool                     boolean{false};
+    double                   number{0};
+    std::string              string;
+    std::vector<json_value>  items;
+    std::vector<std::string> keys; // keys of object items
+
+    const json_value* find(const std::string& key) const {
+        for (size_t i = 0; i < keys.size(); ++i)
+            if (keys[i] == key)
+                return &items[i];
+        return nullptr;
+    }
+};
+
+class json_parser
+{
+public:
+    explicit json_parser(const std::string& text)
+        : pos{text.c_str()}, end{text.c_str() + text.size()} {}
+
+    bool parse(json_value& v) {
+        if (!parse_value(v, 0))
+            return false;
+        skip_spaces();
+        return pos == end;
+    }
+
+private:
+    static constexpr int Max_Depth = 64;
+
+    void skip_spaces() {
+        while (pos != end &&
+               (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r'))
+            ++pos;
+    }
+
+    bool consume(char c) {
+        skip_spaces();
+        if (pos == end || *pos != c)
+            return false;
+        ++pos;
+        return true;
+    }
+
+    bool consume_word(const char* word) {
+        auto size = std::strlen(word);
+        if (static_cast<size_t>(end - pos) < size ||
+            std::strncmp(pos, word, size) != 0)
+            return false;
+        pos += size;
+        return true;
+    }
+
+    bool parse_value(json_value& v, int depth) {
+        if (depth > Max_Depth)
+            return false;
+        skip_spaces();
+        if (pos == end)
+            return false;
+        switch (*pos) {
+        case '{':
+            return parse_object(v, depth);
+        case '[':
+            return parse_array(v, depth);
+        case '"':
+            v.type = json_value::type_t::string;
+            return parse_string(v.string);
+        case 't':
+        case 'f':
+            v.type    = json_value::type_t::boolean;
+            v.boolean = *pos == 't';
+            return consume_word(v.boolean ? "true" : "false");
+        case 'n':
+            v.type = json_value::type_t::null;
+            return consume_word("null");
+        default: {
+            // text is null terminated, so strtod stops in it
+            char* num_end = nullptr;
+            v.type        = json_value::type_t::number;
+            v.number      = std::strtod(pos, &num_end);
+            if (num_end == pos)
+                return false;
+            pos = num_end;
+            return true;
+        }
+        }
+    }
+
+    bool parse_object(json_value& v, int depth) {
+        v.type = json_value::type_t::object;
+        ++pos;
+        if (consume('}'))
+            return true;
+        do {
+            skip_spaces();
+            std::string key;
+            if (pos == end || *pos != '"' || !parse_string(key) ||
+                !consume(':'))
+                return false;
+            v.keys.emplace_back(std::move(key));
+            if (!parse_value(v.items.emplace_back(), depth + 1))
+                return false;
+        } while (consume(','));
+        return consume('}');
+    }
+
+    bool parse_array(json_value& v, int depth) {
+        v.type = json_value::type_t::array;
+        ++pos;
+        if (consume(']'))
+            return true;
+        do {
+            if (!parse_value(v.items.emplace_back(), depth + 1))
+                return false;
+        } while (consume(','));
+        return consume(']');
+    }
+
+    bool parse_string(std::string& str) {
+        ++pos; // opening quote
+        while (pos != end && *pos != '"') {
+            if (*pos != '\\') {
+                str.push_back(*pos++);
+                continue;
+            }
+            if (++pos == end)
+                return false;
+            switch (*pos++) {
+            case 'n':
+                str.push_back('\n');
+                break;
+            case 't':
+                str.push_back('\t');
+                break;
+            case 'r':
+                str.push_back('\r');
+                break;
+            case 'b':
+                str.push_back('\b');
+                break;
+            case 'f':
+                str.push_back('\f');
+                break;
+            case 'u': {
+                // only ascii escapes are expected in config files
+                if (end - pos < 4)
+                    return false;
+                auto code =
+                    std::strtol(std::string{pos, 4}.c_str(), nullptr, 16);
+                str.push_back(code < 0x80 ? static_cast<char>(code) : '?');
+                pos += 4;
+                break;
+            }
+            default: // quote, back slash and slash
+                str.push_back(pos[-1]);
+            }
+        }
+        if (pos == end)
+            return false;
+        ++pos; // closing quote
+        return true;
+    }
+
+    const char* pos;
+    const char* end;
+};
+
+template <typename T> struct names_t {
+    const char* name;
+    T           value;
+};
+
+constexpr names_t<codec_t> Codec_Names[] = {
+    {"h264", codec_t::h264},
+    {"hevc", codec_t::hevc},
+    {"av1", codec_t::av1},
+    {"vp9", codec_t::vp9},
+    {"ac3", codec_t::ac3},
+    {"mp2", codec_t::mp2},
+    {"mp3", codec_t::mp3},
+    {"aac", codec_t::aac},
+};
+
+constexpr names_t<rate_control_t> Rate_Control_Names[] = {
+    {"capped", rate_control_t::capped},
+    {"cbr", rate_control_t::cbr},
+    {"crf", rate_control_t::crf},
+};
+
+constexpr names_t<scale_algorithm_t> Scale_Algorithm_Names[] = {
+    {"fast_bilinear", scale_algorithm_t::fast_bilinear},
+    {"bilinear", scale_algorithm_t::bilinear},
+    {"bicubic", scale_algorithm_t::bicubic},
+    {"area", scale_algorithm_t::area},
+    {"point", scale_algorithm_t::point},
+    {"lanczos", scale_algorithm_t::lanczos},
+};
+
+constexpr names_t<container_t> Container_Names[] = {
+    {"matroska", container_t::matroska},
+    {"mpegts", container_t::mpegts},
+    {"flv", container_t::flv},
+};
+
+constexpr names_t<file_format_t> Format_Names[] = {
+    {"mp4", file_format_t::mp4},
+    {"ts", file_format_t::ts},
+    {"mkv", file_format_t::mkv},
+    {"avi", file_format_t::avi},
+    {"flv", file_format_t::flv},
+    {"mov", file_format_t::mov},
+    {"webm", file_format_t::webm},
+};
+
+// reads fields of json objects, reports first invalid field
+struct config_reader {
+    std::string error;
+
+    template <typename T>
+    void read(const json_value& obj, const char* key, T& out) {
+        if (const auto* v = obj.find(key); v && error.empty())
+            if (!convert(*v, out))
+                error = key;
+    }
+
+    template <typename T, size_t N>
+    void read(
+        const json_value& obj,
+        const char*       key,
+        T&                out,
+        const names_t<T> (&names)[N]) {
+        const auto* v = obj.find(key);
+        if (!v || !error.empty())
+            return;
+        if (v->type == json_value::type_t::string)
+            for (const auto& n : names)
+                if (to_lower(v->string) == n.name) {
+                    out = n.value;
+                    return;
+                }
+        error = key;
+    }
+
+    bool convert(const json_value& v, std::string& out) {
+        out = v.string;
+        return v.type == json_value::type_t::string;
+    }
+
+    bool convert(const json_value& v, bool& out) {
+        out = v.boolean;
+        return v.type == json_value::type_t::boolean;
+    }
+
+    template <typename T>
+    std::enable_if_t<std::is_arithmetic_v<T>, bool>
+    convert(const json_value& v, T& out) {
+        if (v.type != json_value::type_t::number ||
+            (std::is_unsigned_v<T> && v.number < 0))
+            return false;
+        out = static_cast<T>(v.number);
+        return true;
+    }
+
+    bool convert(const json_value& v, std::vector<int>& out) {
+        if (v.type != json_value::type_t::array)
+            return false;
+        out.clear();
+        for (const auto& item : v.items)
+            if (!convert(item, out.emplace_back()))
+                return false;
+        return true;
+    }
+
+    bool convert(const json_value& v, encoding_t& out) {
+        if (v.type != json_value::type_t::object)
+            return false;
+        read(v, "codec", out.codec, Codec_Names);
+        read(v, "width", out.width);
+        read(v, "height", out.height);
+        read(v, "max_bitrate", out.max_bitrate);
+        read(v, "frame_rate", out.frame_rate);
+        read(v, "sample_rate", out.sample_rate);
+        read(v, "sample_fmt", out.sample_fmt);
+        read(v, "channel_layout", out.channel_layout);
+        read(v, "preset", out.preset);
+        read(v, "tune", out.tune);
+        read(v, "rate_control", out.rate_control, Rate_Control_Names);
+        read(v, "crf", out.crf);
+        read(v, "gop", out.gop);
+        read(v, "b_frames", out.b_frames);
+        read(v, "lookahead", out.lookahead);
+        read(v, "threads", out.threads);
+        return error.empty();
+    }
+
+    bool convert(const json_value& v, record_options_t& out) {
+        if (v.type != json_value::type_t::object)
+            return false;
+        read(v, "path", out.path);
+        read(v, "format", out.format, Format_Names);
+        read(v, "video_encoding", out.video_encoding);
+        read(v, "audio_encoding", out.audio_encoding);
+        read(v, "file_size", out.file_size);
+        read(v, "file_duration", out.file_duration);
+        read(v, "write_interval", out.write_interval);
+        read(v, "record_audio", out.record_audio);
+        read(v, "max_age", out.max_age);
+        read(v, "max_size", out.max_size);
+        read(v, "recycle", out.recycle);
+        return error.empty();
+    }
+
+    bool convert(const json_value& v, source_config_t& out) {
+        if (v.type != json_value::type_t::object)
+            return false;
+        auto& a = out.args;
+        read(v, "name", a.name);
+        read(v, "url", a.url);
+        read(v, "auth_session", a.auth_session);
+        read(v, "video_encoding", a.video_encoding);
+        read(v, "audio_encoding", a.audio_encoding);
+        read(v, "container", a.container, Container_Names);
+        read(v, "pre_record_duration", a.pre_record_duration);
+        read(v, "cpus", a.cpus);
+        read(v, "numa_node", a.numa_node);
+        read(v, "probe_size", a.probe_size);
+        read(v, "analyze_duration", a.analyze_duration);
+        read(v, "probe_cache", a.probe_cache);
+        read(v, "timeout", a.timeout);
+        read(v, "viewless_timeout", a.viewless_timeout);
+        read(v, "standby_duration", a.standby_duration);
+        read(v, "encoder_pool_size", a.encoder_pool_size);
+        read(v, "encoder_idle_timeout", a.encoder_idle_timeout);
+        read(v, "scale_algorithm", a.scale_algorithm, Scale_Algorithm_Names);
+        read(v, "scale_threads", a.scale_threads);
+        read(v, "thumbnail_interval", a.thumbnail_interval);
+        read(v, "thumbnail_height", a.thumbnail_height);
+        // record is true for default options, an object for others
+        if (const auto* r = v.find("record"); r && error.empty()) {
+            if (r->type == json_value::type_t::object)
+                out.record = convert(*r, out.record_options);
+            else if (r->type == json_value::type_t::null)
+                out.record = false;
+            else if (!convert(*r, out.record))
+                error = "record";
+        }
+        if (error.empty() && (a.name.empty() || a.url.empty()))
+            error = "name/url";
+        return error.empty();
+    }
+};
+
+} // namespace
+
+std::error_code
+read_config_file(const std::string& path, streamer_config_t& config) {
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+        return make_err(error_t::not_found);
+    std::string text{
+        std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+    json_value root;
+    if (!json_parser{text}.parse(root) ||
+        root.type != json_value::type_t::object) {
+        logError("config: invalid json file: %s", path);
+        return make_err(error_t::invalid_argument);
+    }
+
+    config_reader reader;
+    reader.read(root, "startup_rate", config.startup_rate);
+    reader.read(root, "max_concurrent_opens", config.max_concurrent_opens);
+    if (const auto* sources = root.find("sources"); sources) {
+        if (sources->type != json_value::type_t::array)
+            reader.error = "sources";
+        for (const auto& s : sources->items) {
+            if (!reader.error.empty())
+                break;
+            source_config_t sc;
+            if (reader.convert(s, sc))
+                config.sources.emplace_back(std::move(sc));
+            else if (reader.error.empty())
+                reader.error = "sources";
+        }
+    }
+    if (!reader.error.empty()) {
+        logError("config: invalid field: %s in file: %s", reader.error, path);
+        return make_err(error_t::invalid_argument);
+    }
+    return std::error_code{};
+}
+
+} // namespace lxstreamer
@@ -0,0 +1,44 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#ifndef SOURCE_CONFIG_HPP
+#define SOURCE_CONFIG_HPP
+
+#include "common_types.hpp"
+
+#include <list>
+#include <system_error>
+
+namespace lxstreamer {
+
+/// contents of a streamer config file
+struct streamer_config_t {
+    int64_t startup_rate{-1};         ///< -1 if not defined
+    int64_t max_concurrent_opens{-1}; ///< -1 if not defined
+    std::list<source_config_t> sources;
+};
+
+/// reads json config file at <path> into <config>. format:
+/// {
+///   "startup_rate": 50, "max_concurrent_opens": 16,
+///   "sources": [{
+///     "name": "cam1", "url": "rtsp://...", "auth_session": "",
+///     "video_encoding": {"codec": "h264", "height": 720, ...},
+///     "audio_encoding": {"codec": "aac", ...}, "container": "mpegts",
+///     <other source_args_t fields by name>,
+///     "record": {"path": "", "format": "mkv", "file_size": 100,
+///                <other record_options_t fields by name>}
+///               or true for default options, false or null for none
+///   }]
+/// }
+std::error_code
+read_config_file(const std::string& path, streamer_config_t& config);
+
+} // namespace lxstreamer
+
+#endif // SOURCE_CONFIG_HPP
@@ -13,6 +13,10 @@
 
 namespace lxstreamer {
 
+// short probe of reconnecting sources whose streams are cached
+constexpr const int64_t Cached_Probe_Size       = 32 * 1024;
+constexpr const int64_t Cached_Analyze_Duration = 500 * 1000; // us
+
 std::string
 preferred_video_framework() {
 #if defined(__linux__)
@@ -66,9 +70,17 @@ source_data::load_input() {
     }
     iargs.url = str;
 
+    // recordings are opened by their first file as stream layout
+    auto url = iargs.url;
+    if (playlist::is_playlist_url(url)) {
+        if (auto ret = iplaylist.load(iargs.url, url); ret != 0)
+            return ret;
+    } else
+        iplaylist.reset();
+
     dictionary      options;
     std::error_code ec;
-    demux_data.is_local = std::filesystem::is_regular_file(iargs.url, ec);
+    demux_data.is_local = std::filesystem::is_regular_file(url, ec);
     if (input_format) {
         logTrace("webcam detected: src: %s", iargs.name);
     } else if (demux_data.is_local) {
@@ -80,13 +92,11 @@ source_data::load_input() {
     }
 
     demux_data.inter_handler.set_context(ctx);
+    demux_data.inter_handler.set_timeout(std::chrono::seconds{iargs.timeout});
 
-    const auto ret = avformat_open_input(
-        &ctx, iargs.url.data(), input_format, options.ref());
+    const auto ret =
+        avformat_open_input(&ctx, url.data(), input_format, options.ref());
     if (ret == 0) {
-        // set load parameters
-        // ctx->probesize = probe_size;
-        // ctx->max_analyze_duration = analyze_msec * 1000;
         ctx->flags |= AVFMT_FLAG_GENPTS | AVFMT_FLAG_FLUSH_PACKETS;
     } else {
         input_ctx.release();
@@ -97,7 +107,35 @@ source_data::load_input() {
 int
 source_data::find_info() {
     AVFormatContext* ctx = input_ctx.get();
-    avformat_find_stream_info(ctx, nullptr);
+    const auto&      url = iargs.url;
+    const bool use_cache = iargs.probe_cache && !demux_data.is_local &&
+                           !input_format && !iplaylist.is_loaded();
+
+    // a short probe is enough to validate cached streams of reconnecting
+    // sources, missing parameters are taken from cache
+    const auto default_size     = ctx->probesize;
+    const auto default_duration = ctx->max_analyze_duration;
+    bool       probed           = false;
+    if (use_cache && super.probes.matches(url, ctx)) {
+        ctx->probesize            = Cached_Probe_Size;
+        ctx->max_analyze_duration = Cached_Analyze_Duration;
+        avformat_find_stream_info(ctx, nullptr);
+        super.probes.complete(url, ctx);
+        probed = probe_cache::is_complete(ctx);
+        if (!probed) {
+            logInfo("source probe cache is stale: src: %s", iargs.name);
+            super.probes.remove(url);
+        }
+    }
+    if (!probed) {
+        ctx->probesize = iargs.probe_size > 0 ? iargs.probe_size : default_size;
+        ctx->max_analyze_duration = iargs.analyze_duration > 0
+                                        ? iargs.analyze_duration * 1000
+                                        : default_duration;
+        avformat_find_stream_info(ctx, nullptr);
+    }
+    if (use_cache && probe_cache::is_complete(ctx))
+        super.probes.store(url, ctx);
 
     auto fill_stream_info = [&](stream_data& s, int idx) {
         s.stream_idx = idx;
@@ -124,12 +162,25 @@ source_data::find_info() {
     if (demux_data.video_stream.stream_idx < 0 &&
         demux_data.audio_stream.stream_idx < 0)
         return demux_data.video_stream.stream_idx;
+    else if (iplaylist.is_loaded())
+        return iplaylist.open(ctx);
     else
         return 0;
 }
 
+int
+source_data::read_packet(AVPacket* pkt) {
+    if (iplaylist.is_loaded())
+        return iplaylist.read_packet(pkt);
+    return av_read_frame(input_ctx.get(), pkt);
+}
+
 bool
 source_data::seek_to(int64_t time) {
+    if (iplaylist.is_loaded()) {
+        demux_data.local_file.seeked = true;
+        return iplaylist.seek(time);
+    }
     auto duration         = input_ctx->duration;
     auto duration_seconds = av_rescale_q(duration, {1, AV_TIME_BASE}, {1, 1});
     auto pos =
@@ -151,9 +202,34 @@ source_data::calculate_progress(AVPacket* pkt) {
     if (!stream)
         return -1;
     auto elapsed = av_rescale_q(pkt->pts, stream->time_base, {1, AV_TIME_BASE});
-    auto duration = input_ctx->duration;
+    auto duration =
+        iplaylist.is_loaded() ? iplaylist.duration() : input_ctx->duration;
     return double(elapsed) / std::max(int64_t{1}, duration);
 }
 
+void
+source_data::pin_thread() const {
+    // memory is allocated on the node which first touches it, so pinning
+    // threads also keeps frames and packets of the source on its node
+    if (pinned_cpus.empty())
+        return;
+    if (!set_thread_affinity(pinned_cpus))
+        logWarn("source failed to set thread affinity: src: %s", iargs.name);
+}
+
+std::vector<int>
+source_data::resolve_cpus(const source_args_t& args) {
+    if (!args.cpus.empty())
+        return args.cpus;
+    auto cpus = numa_node_cpus(args.numa_node);
+    if (args.numa_node >= 0 && cpus.empty())
+        logWarn(
+            "source failed to find cpus of numa node %d, threads are not "
+            "pinned: src: %s",
+            args.numa_node,
+            args.name);
+    return cpus;
+}
+
 
 } // namespace lxstreamer
@@ -13,9 +13,13 @@
 #include "codec/encoder.hpp"
 #include "codec/resampler.hpp"
 #include "codec/scaler.hpp"
+#include "codec/thumbnailer.hpp"
 #include "demuxer_data.hpp"
 #include "ffmpeg_types.hpp"
+#include "playlist.hpp"
+#include "pre_record_buffer.hpp"
 #include "streamer_data.hpp"
+#include "worker_pool.hpp"
 #include "write/recorder.hpp"
 #include "write/viewer.hpp"
 
@@ -24,6 +28,7 @@
 #include <mutex>
 #include <system_error>
 #include <unordered_map>
+#include <vector>
 
 namespace lxstreamer {
 
@@ -46,28 +51,53 @@ struct source_data {
     encoder                            iencoder{*this};
     scaler                             iscaler{*this};
     resampler                          iresampler{*this};
+    thumbnailer                        ithumbnailer{*this};
+    // guards viewers and encodings of writers, which set them on their own
+    // threads
+    std::mutex                         mutex;
     encoder_config                     view_encoding;
     encoder_config                     record_encoding;
+    pre_record_buffer                  pre_record;
+    playlist                           iplaylist;
+    // cpus or cpus of numa node of source, threads are not pinned if empty
+    std::vector<int>                   pinned_cpus;
+    // runs encoders of a video packet in parallel
+    worker_pool                        encode_workers{[this] { pin_thread(); }};
 
 
     explicit source_data(const streamer_data& s, const source_args_t& args)
-        : super{s}, iargs{args} {}
+        : super{s}, iargs{args}, pinned_cpus{resolve_cpus(args)} {}
 
     /// a callback that is called when source is opened
     virtual void on_open() = 0;
     /// a callback for every packet that is read by demuxer
     virtual void on_packet(const AVPacket* pkt) = 0;
+    /// a callback that is called after demuxer seeks a local file
+    virtual void on_seek() = 0;
+    /// a callback that is called when standby of source ends, returns false
+    /// if it's needed again and shouldn't be closed
+    virtual bool on_standby_end() = 0;
 
 
     int load_input();
 
     int find_info();
 
+    int read_packet(AVPacket* pkt);
+
     void check_webcam();
 
     bool seek_to(int64_t time);
 
     double calculate_progress(AVPacket* pkt);
+
+    /// pins calling thread to cpus or numa node of source if defined.
+    /// threads created afterwards by it, like codec threads, inherit it
+    void pin_thread() const;
+
+    /// returns cpus threads of source are pinned to, warns if numa node of
+    /// source has no known cpus
+    static std::vector<int> resolve_cpus(const source_args_t& args);
 };
 
 } // namespace lxstreamer
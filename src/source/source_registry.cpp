@@ -0,0 +1,125 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#include "source_registry.hpp"
+#include "source.hpp"
+
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+
+namespace lxstreamer {
+
+namespace {
+
+// removed sources still used by other threads are checked at this interval
+constexpr const auto Reap_Interval = std::chrono::milliseconds{50};
+
+} // namespace
+
+struct source_registry::impl {
+    using map_ptr = std::shared_ptr<const map_t>;
+
+    map_ptr                 sources{std::make_shared<const map_t>()};
+    std::mutex              mutex; // serializes changes
+    std::condition_variable cv;
+    bool                    running{false};
+    std::thread             reaper;
+    std::list<source_ptr>   removed;
+
+    ~impl() {
+        {
+            std::scoped_lock lock{mutex};
+            running = false;
+        }
+        cv.notify_all();
+        if (reaper.joinable())
+            reaper.join();
+        removed.clear();
+    }
+
+    void reap() {
+        std::unique_lock<std::mutex> lock{mutex};
+        while (running || !removed.empty()) {
+            std::list<source_ptr> unused;
+            for (auto it = removed.begin(); it != removed.end();) {
+                if (it->use_count() == 1 || !running)
+                    unused.splice(unused.end(), removed, it++);
+                else
+                    ++it;
+            }
+            if (!unused.empty()) {
+                // last reference is released here, so joining source
+                // threads never blocks callers or http server
+                lock.unlock();
+                unused.clear();
+                lock.lock();
+            } else if (removed.empty())
+                cv.wait(lock, [&] { return !running || !removed.empty(); });
+            else // they are still used by other threads
+                cv.wait_for(lock, Reap_Interval, [&] { return !running; });
+        }
+    }
+};
+
+source_registry::source_registry() : pimpl{std::make_unique<impl>()} {}
+
+source_registry::~source_registry() {}
+
+source_registry::source_ptr
+source_registry::find(const std::string& name) const {
+    auto sources = snapshot();
+    if (auto it = sources->find(name); it != sources->cend())
+        return it->second;
+    return nullptr;
+}
+
+std::shared_ptr<const source_registry::map_t>
+source_registry::snapshot() const {
+    return std::atomic_load(&pimpl->sources);
+}
+
+bool
+source_registry::add(const std::string& name, source_ptr src) {
+    std::scoped_lock lock{pimpl->mutex};
+    if (pimpl->sources->count(name))
+        return false;
+    auto sources = std::make_shared<map_t>(*pimpl->sources);
+    sources->emplace(name, std::move(src));
+    std::atomic_store(&pimpl->sources, impl::map_ptr{std::move(sources)});
+    return true;
+}
+
+bool
+source_registry::remove(const std::string& name) {
+    source_ptr src;
+    {
+        std::scoped_lock lock{pimpl->mutex};
+        auto             it = pimpl->sources->find(name);
+        if (it == pimpl->sources->cend())
+            return false;
+        src          = it->second;
+        auto sources = std::make_shared<map_t>(*pimpl->sources);
+        sources->erase(name);
+        std::atomic_store(&pimpl->sources, impl::map_ptr{std::move(sources)});
+    }
+    src->stop();
+    {
+        std::scoped_lock lock{pimpl->mutex};
+        pimpl->removed.emplace_back(std::move(src));
+        if (!pimpl->running) {
+            pimpl->running = true;
+            pimpl->reaper  = std::thread{[this] { pimpl->reap(); }};
+        }
+    }
+    pimpl->cv.notify_all();
+    return true;
+}
+
+} // namespace lxstreamer
@@ -0,0 +1,53 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#ifndef SOURCE_REGISTRY_HPP
+#define SOURCE_REGISTRY_HPP
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace lxstreamer {
+
+struct source;
+
+/// sources of a streamer by name. lookups read an immutable snapshot
+/// without locking and changes replace it, so any thread can use it.
+/// removed sources are stopped at once and destroyed on a background
+/// thread when they are not used anymore
+class source_registry
+{
+public:
+    using source_ptr = std::shared_ptr<source>;
+    using map_t      = std::unordered_map<std::string, source_ptr>;
+
+    explicit source_registry();
+    /// destroys all sources
+    ~source_registry();
+
+    /// returns source <name> or nullptr
+    source_ptr find(const std::string& name) const;
+
+    /// returns current sources, it's not affected by later changes
+    std::shared_ptr<const map_t> snapshot() const;
+
+    /// adds <src> as <name>, returns false if it already exists
+    bool add(const std::string& name, source_ptr src);
+
+    /// removes source <name>, returns false if it doesn't exist
+    bool remove(const std::string& name);
+
+protected:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+} // namespace lxstreamer
+
+#endif // SOURCE_REGISTRY_HPP
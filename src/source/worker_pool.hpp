@@ -0,0 +1,121 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace lxstreamer {
+
+/// a few persistent threads which run parallel parts of a task with the
+/// calling thread. threads are made on first use and kept, so a task costs
+/// a wake up instead of creating threads
+class worker_pool
+{
+public:
+    /// <init> is called once on each thread when it's made, like pinning it
+    explicit worker_pool(std::function<void()> init) : init{std::move(init)} {}
+
+    ~worker_pool() {
+        {
+            std::scoped_lock lock{mutex};
+            running = false;
+        }
+        cv.notify_all();
+        for (auto& t : threads)
+            if (t.joinable())
+                t.join();
+    }
+
+    /// calls fn(i) for each i of [0, count) in parallel and returns when all
+    /// are done. the calling thread takes parts too. not reentrant
+    template <typename Fn> void run(size_t count, Fn&& fn) {
+        if (count == 0)
+            return;
+        std::unique_lock<std::mutex> lock{mutex};
+        while (threads.size() + 1 < count)
+            threads.emplace_back([this] { work(); });
+        task.call = [](void* f, size_t i) {
+            (*static_cast<std::remove_reference_t<Fn>*>(f))(i);
+        };
+        task.target = &fn;
+        task.count  = count;
+        next        = 0;
+        ++generation;
+        ++busy;
+        lock.unlock();
+        cv.notify_all();
+
+        run_parts(task);
+        lock.lock();
+        --busy;
+        // parts taken by threads may be still running
+        done_cv.wait(lock, [&] { return busy == 0; });
+        // threads waking up late find nothing to do
+        task = task_t{};
+    }
+
+    worker_pool(const worker_pool&) = delete;
+    worker_pool& operator=(const worker_pool&) = delete;
+
+private:
+    struct task_t {
+        void (*call)(void*, size_t){nullptr};
+        void*  target{nullptr};
+        size_t count{0};
+    };
+
+    void run_parts(const task_t& t) {
+        for (auto i = next++; i < t.count; i = next++)
+            t.call(t.target, i);
+    }
+
+    void work() {
+        init();
+        size_t                       seen = 0;
+        std::unique_lock<std::mutex> lock{mutex};
+        while (true) {
+            cv.wait(lock, [&] { return !running || generation != seen; });
+            if (!running)
+                return;
+            seen = generation;
+            if (task.count == 0)
+                continue; // it's done already
+            // run waits for busy threads, so the task outlives them
+            auto t = task;
+            ++busy;
+            lock.unlock();
+            run_parts(t);
+            lock.lock();
+            if (--busy == 0)
+                done_cv.notify_one();
+        }
+    }
+
+    std::function<void()>    init;
+    std::vector<std::thread> threads;
+    std::mutex               mutex;
+    std::condition_variable  cv;      // wakes up threads on a new task
+    std::condition_variable  done_cv; // wakes up caller of run
+    task_t                   task;    // guarded by mutex
+    std::atomic<size_t>      next{0}; // next part of task
+    size_t                   generation{0};
+    size_t                   busy{0}; // threads running parts of task
+    bool                     running{true};
+};
+
+} // namespace lxstreamer
+
+#endif // WORKER_POOL_HPP
@@ -10,8 +10,11 @@
 #include "error_types.hpp"
 #include "ffmpeg_types.hpp"
 #include "server/http_server.hpp"
+#include "source/source_config.hpp"
 #include "streamer_data.hpp"
 
+#include <unordered_set>
+
 namespace lxstreamer {
 
 struct streamer::impl : public streamer_data {
@@ -38,8 +41,8 @@ streamer::start() {
         return;
     pimpl->running = true;
     pimpl->server.start();
-    for (const auto& s : pimpl->sources)
-        s.second->start();
+    for (const auto& s : *pimpl->sources.snapshot())
+        s.second->start(pimpl->reconnects.start_delay());
 }
 
 void
@@ -48,32 +51,114 @@ streamer::set_ssl_cert_path(std::string cert, std::string key) {
     pimpl->ssl_key_path  = key;
 }
 
+void
+streamer::set_http_threads(size_t count) {
+    pimpl->http_threads = std::max<size_t>(count, 1);
+}
+
 std::error_code
 streamer::add_source(const source_args_t& args) {
     if (pimpl->get_source(args.name))
         return make_err(error_t::already_exists);
-    pimpl->sources.insert({args.name, std::make_unique<source>(*pimpl, args)});
+    auto src = std::make_shared<source>(*pimpl, args);
+    if (!pimpl->sources.add(args.name, src))
+        return make_err(error_t::already_exists);
     if (pimpl->running)
-        pimpl->get_source(args.name)->start();
+        src->start(pimpl->reconnects.start_delay());
     return std::error_code{};
 }
 
 std::error_code
 streamer::remove_source(std::string name) {
-    if (!pimpl->get_source(name))
+    // source is destroyed in background
+    if (!pimpl->sources.remove(name))
         return make_err(error_t::not_found);
-    pimpl->sources.erase(name);
     return std::error_code{};
 }
 
+std::error_code
+streamer::apply_sources(const std::list<source_config_t>& configs) {
+    std::unordered_set<std::string> names;
+    for (const auto& c : configs)
+        if (c.args.name.empty() || !names.insert(c.args.name).second)
+            return make_err(error_t::invalid_argument);
+
+    size_t added = 0, replaced = 0, removed = 0;
+    for (const auto& s : *pimpl->sources.snapshot())
+        if (!names.count(s.first) && pimpl->sources.remove(s.first))
+            ++removed;
+
+    for (const auto& c : configs) {
+        auto src = pimpl->get_source(c.args.name);
+        if (src && !(src->args() == c.args)) {
+            pimpl->sources.remove(c.args.name);
+            src.reset();
+            ++replaced;
+        } else if (!src)
+            ++added;
+        if (!src) {
+            if (auto ec = add_source(c.args); ec)
+                return ec;
+            src = pimpl->get_source(c.args.name);
+        }
+        if (!src)
+            continue;
+        if (c.record && src->is_recording() &&
+            !(src->record_options() == c.record_options))
+            src->stop_recording();
+        if (c.record && !src->is_recording())
+            src->start_recording(c.record_options);
+        else if (!c.record && src->is_recording())
+            src->stop_recording();
+    }
+    logInfo(
+        "applied sources: added: %d replaced: %d removed: %d",
+        static_cast<int>(added),
+        static_cast<int>(replaced),
+        static_cast<int>(removed));
+    return std::error_code{};
+}
+
+std::error_code
+streamer::load_config(const std::string& path) {
+    streamer_config_t config;
+    if (auto ec = read_config_file(path, config); ec)
+        return ec;
+    if (config.startup_rate >= 0)
+        set_startup_rate(static_cast<size_t>(config.startup_rate));
+    if (config.max_concurrent_opens >= 0)
+        set_max_concurrent_opens(
+            static_cast<size_t>(config.max_concurrent_opens));
+    return apply_sources(config.sources);
+}
+
+void
+streamer::set_startup_rate(size_t count) {
+    pimpl->reconnects.set_startup_rate(count);
+}
+
 std::list<std::string>
 streamer::sources() const {
     std::list<std::string> list;
-    for (const auto& l : pimpl->sources)
+    for (const auto& l : *pimpl->sources.snapshot())
         list.emplace_back(l.first);
     return list;
 }
 
+std::error_code
+streamer::source_status(std::string name, source_status_t& status) const {
+    auto src = pimpl->get_source(name);
+    if (!src)
+        return make_err(error_t::not_found);
+    status = src->status();
+    return std::error_code{};
+}
+
+void
+streamer::set_max_concurrent_opens(size_t count) {
+    pimpl->reconnects.set_max_opens(count);
+}
+
 std::error_code
 streamer::start_recording(std::string name, const record_options_t& options) {
     auto src = pimpl->get_source(name);
@@ -90,6 +175,29 @@ streamer::stop_recording(std::string name) {
     return src->stop_recording();
 }
 
+std::error_code
+streamer::find_recordings(
+    std::string                  name,
+    int64_t                      from,
+    int64_t                      to,
+    std::list<record_segment_t>& segments) const {
+    if (from > to)
+        return make_err(error_t::invalid_argument);
+    auto src = pimpl->get_source(name);
+    if (!src)
+        return make_err(error_t::not_found);
+    segments = src->find_recordings(from, to);
+    return std::error_code{};
+}
+
+std::error_code
+streamer::snapshot(std::string name, snapshot_t& snapshot) const {
+    auto src = pimpl->get_source(name);
+    if (!src)
+        return make_err(error_t::not_found);
+    return src->snapshot(snapshot);
+}
+
 std::error_code
 streamer::seek(std::string name, int64_t time) {
     auto src = pimpl->get_source(name);
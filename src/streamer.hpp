@@ -33,15 +33,42 @@ public:
     /// sets pathes for SSL certificate and key files
     void set_ssl_cert_path(std::string cert, std::string key);
 
+    /// sets number of http event loop threads, each accepting connections
+    /// of the port and doing their handshakes and requests. more than one
+    /// is only supported on linux, default is 1. should be called before
+    /// start
+    void set_http_threads(size_t count);
+
     /// adds a source with <args> to be streamed
     std::error_code add_source(const source_args_t& args);
 
     /// removes source <name>
     std::error_code remove_source(std::string name);
 
+    /// makes <configs> the whole set of sources. new ones are added,
+    /// missing ones are removed, changed ones are replaced and recording
+    /// of sources is started or stopped as declared
+    std::error_code apply_sources(const std::list<source_config_t>& configs);
+
+    /// reads a json config file of sources and settings and applies it, see
+    /// source_config.hpp for its format
+    std::error_code load_config(const std::string& path);
+
+    /// sets max number of sources started per second, 0 for no limit which
+    /// is default. sources added together are started gradually
+    void set_startup_rate(size_t count);
+
     /// returns source names
     std::list<std::string> sources() const;
 
+    /// gets connection health of source <name>
+    std::error_code
+    source_status(std::string name, source_status_t& status) const;
+
+    /// sets max number of sources which open their inputs at the same time,
+    /// others wait for them. 0 for no limit, default is 16
+    void set_max_concurrent_opens(size_t count);
+
     /// starts recording source <name> with <options>
     std::error_code
     start_recording(std::string name, const record_options_t& options);
@@ -49,6 +76,21 @@ public:
     /// stops recording source <name>
     std::error_code stop_recording(std::string name);
 
+    /// finds recorded files of source <name> overlapping time range
+    /// [from, to] in milliseconds since epoch, sorted by time. each segment
+    /// has the byte offset of the nearest key frame to start reading from
+    std::error_code find_recordings(
+        std::string                  name,
+        int64_t                      from,
+        int64_t                      to,
+        std::list<record_segment_t>& segments) const;
+
+    /// gets latest jpeg thumbnail of source <name>. thumbnails are made of
+    /// key frames every thumbnail_interval of source or when the latest one
+    /// is old, an idle source is started for it and busy is returned until
+    /// its first one is made
+    std::error_code snapshot(std::string name, snapshot_t& snapshot) const;
+
     /// seeks source <name> to pos if it's a file
     std::error_code seek(std::string name, int64_t time);
 
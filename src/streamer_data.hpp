@@ -10,10 +10,15 @@
 #define STREAMER_DATA_HPP
 
 #include "error_types.hpp"
+#include "source/probe_cache.hpp"
+#include "source/reconnect_scheduler.hpp"
 #include "source/source.hpp"
+#include "source/source_registry.hpp"
 #include "utils.hpp"
+#include "write/storage_monitor.hpp"
 #include "write/viewer.hpp"
 
+#include <filesystem>
 #include <memory>
 #include <unordered_map>
 
@@ -26,16 +31,22 @@ struct streamer_data {
     bool        https = true;
     std::string ssl_cert_path;
     std::string ssl_key_path;
+    size_t      http_threads = 1;
 
-    std::unordered_map<std::string, std::unique_ptr<source>> sources;
+    // thread safe, shared by recorders of sources
+    mutable storage_monitor storage;
+    // thread safe, shared by sources
+    mutable probe_cache         probes;
+    mutable reconnect_scheduler reconnects;
+
+    // thread safe, sources are destroyed before other members they use
+    source_registry sources;
 
     explicit streamer_data(int port_, bool https_)
         : port{port_}, https{https_} {}
 
-    source* get_source(std::string name) {
-        if (auto it = sources.find(name); it != sources.cend())
-            return it->second.get();
-        return nullptr;
+    std::shared_ptr<source> get_source(const std::string& name) const {
+        return sources.find(name);
     }
 
     std::error_code
@@ -62,6 +73,45 @@ struct streamer_data {
         }
         return make_err(error_t::not_found);
     }
+
+    /// gets latest thumbnail of a source for a /snapshot?source=x request
+    std::error_code snapshot(std::string query, snapshot_t& snapshot) {
+        auto name = query_value(query, "source");
+        auto src  = get_source(name);
+        if (!src)
+            return make_err(error_t::not_found);
+        if (query_value(query, "session") != src->args().auth_session) {
+            logInfo("authentication failed for src: %s", name);
+            return make_err(error_t::authentication_failed);
+        }
+        return src->snapshot(snapshot);
+    }
+
+    /// resolves <path> of recorded file <file_name> of a source for a
+    /// /recordings/<source>/<file_name> request
+    std::error_code record_file(
+        std::string  source_name,
+        std::string  file_name,
+        std::string  query,
+        std::string& path) {
+        // only plain file names inside records directory are served
+        if (file_name.empty() || file_name.front() == '.' ||
+            file_name.find_first_of("/\\") != std::string::npos)
+            return make_err(error_t::invalid_argument);
+        auto src = get_source(source_name);
+        if (!src)
+            return make_err(error_t::not_found);
+        if (query_value(query, "session") != src->args().auth_session) {
+            logInfo("authentication failed for src: %s", source_name);
+            return make_err(error_t::authentication_failed);
+        }
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        path = (fs::path{src->record_directory()} / file_name).string();
+        if (!fs::is_regular_file(path, ec))
+            return make_err(error_t::not_found);
+        return std::error_code{};
+    }
 };
 
 } // namespace lxstreamer
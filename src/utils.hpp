@@ -14,12 +14,19 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstdio>
 #include <filesystem>
+#include <fstream>
 #include <functional>
 #include <mutex>
+#include <sstream>
+#include <vector>
 
 #if defined(_WIN32)
 #include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
 #endif
 
 namespace lxstreamer {
@@ -192,6 +199,86 @@ logFatal(const std::string& str, Args&&... args) {
 /// other utils
 //-----------------------------------------------------------------
 
+/// mixes hash of <value> into <seed>, unlike xor it depends on order and
+/// equal values don't cancel out each other
+template <typename T>
+inline void
+hash_combine(size_t& seed, const T& value) {
+    seed ^= std::hash<T>{}(value) + 0x9e3779b97f4a7c15ULL + (seed << 6) +
+            (seed >> 2);
+}
+
+/// returns system time in milliseconds since epoch
+inline int64_t
+system_time_ms() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch())
+        .count();
+}
+
+/// returns monotonic time in milliseconds, for measuring intervals
+inline int64_t
+steady_time_ms() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/// pins calling thread to <cpus>, returns false if it fails or is not
+/// supported on the platform
+inline bool
+set_thread_affinity(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto c : cpus)
+        if (c >= 0 && c < CPU_SETSIZE)
+            CPU_SET(c, &set);
+    return CPU_COUNT(&set) > 0 &&
+           pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (auto c : cpus)
+        if (c >= 0 && c < static_cast<int>(sizeof(mask) * 8))
+            mask |= DWORD_PTR{1} << c;
+    return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+    return false;
+#endif
+}
+
+/// returns cpu cores of numa <node>, empty if it's unknown
+inline std::vector<int>
+numa_node_cpus(int node) {
+    std::vector<int> cpus;
+    if (node < 0)
+        return cpus;
+#if defined(__linux__)
+    // a list of ranges like: 0-7,16-23
+    std::ifstream file{
+        "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"};
+    std::string list;
+    std::getline(file, list);
+    std::istringstream stream{list};
+    std::string        range;
+    while (std::getline(stream, range, ',')) {
+        int  first = 0, last = 0;
+        auto n = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (n < 1)
+            continue;
+        for (int c = first; c <= (n == 2 ? last : first); ++c)
+            cpus.push_back(c);
+    }
+#elif defined(_WIN32)
+    GROUP_AFFINITY affinity{};
+    if (GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity))
+        for (int c = 0; c < static_cast<int>(sizeof(KAFFINITY) * 8); ++c)
+            if (affinity.Mask & (KAFFINITY{1} << c))
+                cpus.push_back(c);
+#endif
+    return cpus;
+}
+
 inline std::string
 current_app_path() {
 #if defined(__linux__) || defined(__unix__) || defined(__MACH__)
@@ -0,0 +1,152 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#ifndef PACKET_QUEUE_HPP
+#define PACKET_QUEUE_HPP
+
+#include "ffmpeg_types.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace lxstreamer {
+
+/// a bounded single producer, single consumer queue of packet references.
+/// packets are kept in preallocated slots, so a push only references the
+/// packet data and makes no queue node. producer doesn't wait for room, it
+/// fails when the queue is full, and only takes the lock to wake up a
+/// waiting consumer, so a batch of pushes costs one wake up
+class packet_queue
+{
+public:
+    explicit packet_queue(size_t capacity) {
+        reserve(capacity);
+    }
+
+    ~packet_queue() {
+        clear();
+        for (auto* p : slots)
+            deleter{}(p, false);
+    }
+
+    /// grows capacity, should be called before use
+    void reserve(size_t capacity) {
+        clear();
+        while (slots.size() < capacity)
+            slots.push_back(av_packet_alloc());
+    }
+
+    size_t capacity() const noexcept {
+        return slots.size();
+    }
+
+    size_t size() const noexcept {
+        return tail.load(std::memory_order_acquire) -
+               head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    /// producer: adds a reference of <pkt>, returns false if it's full
+    bool push(const AVPacket* pkt) {
+        auto t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == slots.size())
+            return false;
+        if (av_packet_ref(slots[t % slots.size()], pkt) != 0)
+            return false;
+        // pairs with waiting flag of consumer, both are sequentially
+        // consistent so one of them sees the other
+        tail.store(t + 1, std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_seq_cst)) {
+            // consumer holds the mutex until it's inside wait
+            {
+                std::scoped_lock lock{mutex};
+            }
+            cv.notify_one();
+        }
+        return true;
+    }
+
+    /// consumer: returns oldest packet or nullptr if it's empty
+    AVPacket* front() noexcept {
+        auto h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return nullptr;
+        return slots[h % slots.size()];
+    }
+
+    /// consumer: releases oldest packet
+    void pop() noexcept {
+        auto h = head.load(std::memory_order_relaxed);
+        av_packet_unref(slots[h % slots.size()]);
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    /// consumer: passes all available packets to <fn> in order, tail is read
+    /// once per batch. each packet is released as soon as <fn> returns, so a
+    /// slow write doesn't hold slots of the whole batch. stops at first
+    /// packet <fn> returns false for and returns false
+    template <typename Fn> bool drain(Fn&& fn) {
+        auto h  = head.load(std::memory_order_relaxed);
+        auto t  = tail.load(std::memory_order_acquire);
+        bool ok = true;
+        while (ok && h != t) {
+            auto* pkt = slots[h % slots.size()];
+            ok        = fn(pkt);
+            av_packet_unref(pkt);
+            head.store(++h, std::memory_order_release);
+        }
+        return ok;
+    }
+
+    /// consumer: waits until a packet is available or stop() is called
+    void wait() {
+        std::unique_lock<std::mutex> lock{mutex};
+        waiting.store(true, std::memory_order_seq_cst);
+        cv.wait(lock, [&] {
+            return stopped.load() ||
+                   tail.load(std::memory_order_seq_cst) !=
+                       head.load(std::memory_order_relaxed);
+        });
+        waiting.store(false, std::memory_order_relaxed);
+    }
+
+    /// wakes up consumer and makes next waits return immediately
+    void stop() {
+        {
+            std::scoped_lock lock{mutex};
+            stopped = true;
+        }
+        cv.notify_all();
+    }
+
+    packet_queue(const packet_queue&) = delete;
+    packet_queue& operator=(const packet_queue&) = delete;
+
+private:
+    void clear() noexcept {
+        while (front())
+            pop();
+    }
+
+    std::vector<AVPacket*>          slots;
+    alignas(64) std::atomic<size_t> head{0}; // written by consumer
+    alignas(64) std::atomic<size_t> tail{0}; // written by producer
+    alignas(64) std::atomic_bool    waiting{false};
+    std::atomic_bool                stopped{false};
+    std::mutex                      mutex;
+    std::condition_variable         cv;
+};
+
+} // namespace lxstreamer
+
+#endif // PACKET_QUEUE_HPP
@@ -0,0 +1,287 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#include "record_index.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace lxstreamer {
+
+namespace fs = std::filesystem;
+
+// index file:   header, entry...
+// catalog file: magic, version, record...
+// all values are in host byte order
+constexpr char     index_magic[4]    = {'L', 'X', 'R', 'I'};
+constexpr char     catalog_magic[4]  = {'L', 'X', 'R', 'C'};
+constexpr uint32_t format_version    = 1;
+constexpr int64_t  min_entry_spacing = 500; // ms
+
+struct index_header {
+    char     magic[4];
+    uint32_t version;
+    int64_t  start_time;
+    int64_t  end_time; // -1 while recording
+};
+
+struct index_entry {
+    int64_t time;
+    int64_t offset;
+};
+
+struct catalog_record {
+    int64_t     start_time{-1};
+    int64_t     end_time{-1};
+    std::string file_name;
+};
+
+// serializes catalog writes of recorders and retention
+std::mutex catalog_mutex;
+
+template <typename T>
+bool
+read_value(std::istream& in, T& v) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+}
+
+template <typename T>
+void
+write_value(std::ostream& out, const T& v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+std::string
+catalog_file(const std::string& dir, const std::string& name) {
+    return (fs::path{dir} / (name + ".catalog")).string();
+}
+
+std::string
+index_file(const std::string& file_path) {
+    return file_path + ".idx";
+}
+
+//-----------------------------------------------------------------------------
+
+std::string
+record_directory(const std::string& path, const std::string& name) {
+    std::error_code ec;
+    if (fs::is_regular_file(path, ec))
+        return fs::path{path}.parent_path().string();
+    // a missing path is created as directory by recorder
+    if (!path.empty())
+        return path;
+    return (fs::path{current_app_path()}.parent_path() /
+            std::string{"records"} / name)
+        .string();
+}
+
+record_index::~record_index() {
+    close(last_time);
+}
+
+bool
+record_index::is_open() const {
+    return file.is_open();
+}
+
+bool
+record_index::open(
+    const std::string& file_path,
+    const std::string& source_name,
+    int64_t            start) {
+    close(last_time);
+    file.open(index_file(file_path), std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        logWarn("recorder: failed to create index of file: %s", file_path);
+        return false;
+    }
+    index_header h{};
+    std::memcpy(h.magic, index_magic, sizeof(h.magic));
+    h.version    = format_version;
+    h.start_time = start;
+    h.end_time   = -1;
+    write_value(file, h);
+    file.flush();
+
+    catalog_path = catalog_file(
+        fs::path{file_path}.parent_path().string(), source_name);
+    file_name  = fs::path{file_path}.filename().string();
+    start_time = start;
+    last_time  = start;
+    entries    = 0;
+    // registered while recording, so an open file can also be found
+    append_catalog(-1);
+    return true;
+}
+
+void
+record_index::add(int64_t time, int64_t offset) {
+    if (!file.is_open())
+        return;
+    if (entries > 0 && time - last_time < min_entry_spacing)
+        return;
+    write_value(file, index_entry{time, offset});
+    file.flush();
+    last_time = time;
+    ++entries;
+}
+
+void
+record_index::close(int64_t end_time) {
+    if (!file.is_open())
+        return;
+    if (end_time < start_time)
+        end_time = std::max(start_time, last_time);
+    file.seekp(offsetof(index_header, end_time));
+    write_value(file, end_time);
+    file.close();
+    append_catalog(end_time);
+    start_time = last_time = -1;
+}
+
+void
+write_catalog_header(std::ostream& out) {
+    out.write(catalog_magic, sizeof(catalog_magic));
+    write_value(out, format_version);
+}
+
+void
+write_catalog_record(std::ostream& out, const catalog_record& r) {
+    write_value(out, r.start_time);
+    write_value(out, r.end_time);
+    write_value(out, static_cast<uint16_t>(r.file_name.size()));
+    out.write(r.file_name.data(), r.file_name.size());
+}
+
+void
+record_index::append_catalog(int64_t end_time) {
+    std::scoped_lock lock{catalog_mutex};
+    std::error_code  ec;
+    bool             is_new = !fs::exists(catalog_path, ec);
+    std::ofstream    out{catalog_path, std::ios::binary | std::ios::app};
+    if (!out.is_open()) {
+        logWarn("recorder: failed to write catalog: %s", catalog_path);
+        return;
+    }
+    if (is_new)
+        write_catalog_header(out);
+    write_catalog_record(out, {start_time, end_time, file_name});
+}
+
+//-----------------------------------------------------------------------------
+
+// returns last catalog records of files, a later record of a file (its close)
+// overrides the former one (its open)
+std::map<std::string, catalog_record>
+read_catalog(const std::string& path) {
+    std::map<std::string, catalog_record> records;
+
+    std::ifstream in{path, std::ios::binary};
+    char          magic[4] = {0};
+    uint32_t      version  = 0;
+    if (!in.read(magic, sizeof(magic)) || !read_value(in, version) ||
+        std::memcmp(magic, catalog_magic, sizeof(magic)) != 0 ||
+        version != format_version)
+        return records;
+
+    while (in) {
+        catalog_record r;
+        uint16_t       size = 0;
+        if (!read_value(in, r.start_time) || !read_value(in, r.end_time) ||
+            !read_value(in, size))
+            break;
+        r.file_name.resize(size);
+        if (!in.read(r.file_name.data(), size))
+            break;
+        records[r.file_name] = std::move(r);
+    }
+    return records;
+}
+
+// fills byte offset of last key frame at or before <time> and end time of
+// unfinished files from their index
+void
+read_index(const std::string& path, int64_t time, record_segment_t& seg) {
+    std::ifstream in{path, std::ios::binary};
+    index_header  h{};
+    if (!read_value(in, h) ||
+        std::memcmp(h.magic, index_magic, sizeof(h.magic)) != 0 ||
+        h.version != format_version)
+        return;
+    index_entry e{};
+    while (read_value(in, e)) {
+        if (e.time <= time)
+            seg.offset = e.offset;
+        if (h.end_time < 0)
+            seg.end_time = std::max(seg.end_time, e.time);
+    }
+}
+
+std::list<record_segment_t>
+find_record_segments(
+    const std::string& dir, const std::string& name, int64_t from, int64_t to) {
+    std::vector<record_segment_t> found;
+    for (auto& [file_name, r] : read_catalog(catalog_file(dir, name))) {
+        auto            path = (fs::path{dir} / file_name).string();
+        std::error_code ec;
+        if (!fs::exists(path, ec))
+            continue;
+        record_segment_t seg;
+        seg.path       = path;
+        seg.start_time = r.start_time;
+        seg.end_time   = std::max(r.start_time, r.end_time);
+        if (seg.start_time > to)
+            continue;
+        read_index(index_file(path), from, seg);
+        if (seg.end_time < from)
+            continue;
+        found.emplace_back(std::move(seg));
+    }
+    std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) {
+        return a.start_time < b.start_time;
+    });
+    return {found.begin(), found.end()};
+}
+
+void
+remove_record_file(const std::string& path) {
+    std::error_code ec;
+    fs::remove(path, ec);
+    fs::remove(index_file(path), ec);
+}
+
+void
+compact_catalog(const std::string& dir, const std::string& name) {
+    std::scoped_lock lock{catalog_mutex};
+    const auto&      path    = catalog_file(dir, name);
+    const auto&      records = read_catalog(path);
+    const auto&      temp    = path + ".tmp";
+    {
+        std::ofstream out{temp, std::ios::binary | std::ios::trunc};
+        if (!out.is_open())
+            return;
+        write_catalog_header(out);
+        std::error_code ec;
+        for (const auto& [file_name, r] : records)
+            if (fs::exists(fs::path{dir} / file_name, ec))
+                write_catalog_record(out, r);
+    }
+    std::error_code ec;
+    fs::rename(temp, path, ec);
+    if (ec)
+        logWarn("recorder: failed to compact catalog: %s", path);
+}
+
+} // namespace lxstreamer
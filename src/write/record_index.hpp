@@ -0,0 +1,72 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#ifndef RECORD_INDEX_HPP
+#define RECORD_INDEX_HPP
+
+#include "common_types.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <string>
+
+namespace lxstreamer {
+
+/// returns directory of recorded files for source <name> and record <path>
+std::string
+record_directory(const std::string& path, const std::string& name);
+
+/// writes a sidecar index (<file>.idx) of key frame times and byte offsets
+/// for a recorded file, and registers the file in catalog of the source
+/// (<dir>/<source>.catalog) on open and close. times are in ms since epoch
+struct record_index {
+    ~record_index();
+
+    bool is_open() const;
+
+    /// creates index of <file_path> starting at <start_time>
+    bool open(
+        const std::string& file_path,
+        const std::string& source_name,
+        int64_t            start_time);
+
+    /// adds a key frame at <time> which is written at or after <offset>
+    void add(int64_t time, int64_t offset);
+
+    /// sets end time and closes index
+    void close(int64_t end_time);
+
+private:
+    void append_catalog(int64_t end_time);
+
+    std::ofstream file;
+    std::string   catalog_path;
+    std::string   file_name;
+    int64_t       start_time{-1};
+    int64_t       last_time{-1};
+    size_t        entries{0};
+};
+
+/// returns recorded files of source <name> in <dir> overlapping [from, to]
+/// sorted by start time, missing files are skipped
+std::list<record_segment_t>
+find_record_segments(
+    const std::string& dir, const std::string& name, int64_t from, int64_t to);
+
+/// removes recorded file at <path> with its index
+void
+remove_record_file(const std::string& path);
+
+/// rewrites catalog of source <name> in <dir> without removed files
+void
+compact_catalog(const std::string& dir, const std::string& name);
+
+} // namespace lxstreamer
+
+#endif // RECORD_INDEX_HPP
@@ -8,10 +8,10 @@
 
 #include "recorder.hpp"
 #include "ffmpeg_types.hpp"
+#include "packet_queue.hpp"
 #include "recorder_data.hpp"
 
 #include <atomic>
-#include <mutex>
 #include <queue>
 #include <system_error>
 #include <thread>
@@ -21,11 +21,9 @@ namespace lxstreamer {
 constexpr const int max_pkt_count = 256;
 
 struct recorder::impl : public recorder_data {
-    std::queue<packet_ref, std::list<packet_ref>> queue;
+    packet_queue                                  queue{max_pkt_count};
     std::atomic_bool                              running{false};
     std::thread                                   worker;
-    std::mutex                                    mutex;
-    std::condition_variable                       cv;
     std::queue<packet_ref, std::list<packet_ref>> rec_buffer;
 
 public:
@@ -33,7 +31,7 @@ public:
 
     ~impl() {
         running = false;
-        cv.notify_all();
+        queue.stop();
         if (worker.joinable()) {
             try {
                 worker.join();
@@ -58,7 +56,10 @@ public:
 
 void
 recorder::impl::start_worker() {
-    worker = std::thread{[this]() { run(); }};
+    worker = std::thread{[this]() {
+        sd->pin_thread();
+        run();
+    }};
 }
 
 void
@@ -69,21 +70,19 @@ recorder::impl::run() {
                 break;
         }
 
-        std::unique_lock<std::mutex> lock(mutex);
-        cv.wait(lock, [&] { return !running.load() || !queue.empty(); });
-        while (!queue.empty()) {
-            const auto pkt = queue.front().get();
+        queue.wait();
+        while (const auto pkt = queue.front()) {
 
             size_t passed = buffer_write_time.seconds();
 
             if (pkt->pts == AV_NOPTS_VALUE)
-                set_packet_times(const_cast<AVPacket*>(pkt));
+                set_packet_times(pkt);
             if (sd->record_options.write_interval > 0) {
                 rec_buffer.emplace(pkt);
                 if (passed >= sd->record_options.write_interval)
                     write_buffer();
             } else {
-                if (write_packet(pkt) < 0) {
+                if (write_indexed(pkt) < 0) {
                     running = false;
                     break;
                 } else if (passed >= 5)
@@ -103,7 +102,7 @@ void
 recorder::impl::write_buffer() {
     while (!rec_buffer.empty()) {
         const auto pkt = rec_buffer.front().get();
-        if (write_packet(pkt) < 0) {
+        if (write_indexed(pkt) < 0) {
             running = false;
             break;
         }
@@ -130,7 +129,7 @@ recorder::impl::check_limits(int packet_size, int64_t packet_time) {
         (c.file_duration > 0 && duration > c.file_duration))
         return false;
     // finish on low space
-    if (real_elapsed % 10 == 0 && !check_space_limit())
+    if (!check_space_limit())
         return false;
     return true;
 }
@@ -162,6 +161,9 @@ recorder::impl::finalize_record() {
     write_buffer();
     finalize();
     close();
+    // next file starts with a key frame if video is re-encoded
+    if (is_valid(sd->record_encoding.video))
+        sd->iencoder.request_keyframe(sd->record_encoding.video_id);
 }
 
 recorder::recorder() : pimpl{std::make_unique<impl>()} {}
@@ -173,6 +175,8 @@ recorder::init(source_data* s) {
     if (!s)
         return make_err(error_t::invalid_argument);
     pimpl->sd = s;
+    // leave room for pre-recorded packets flushed on start
+    pimpl->queue.reserve(max_pkt_count + s->pre_record.size());
     return std::error_code{};
 }
 
@@ -186,12 +190,7 @@ int
 recorder::write_packet(const AVPacket* pkt) {
     if (!pimpl->running.load(std::memory_order_relaxed))
         return AVERROR_EOF;
-    {
-        std::scoped_lock lock{pimpl->mutex};
-        if (pimpl->queue.size() < max_pkt_count)
-            pimpl->queue.emplace(pkt);
-    }
-    pimpl->cv.notify_all();
+    pimpl->queue.push(pkt);
     return 0;
 }
 
@@ -71,20 +71,17 @@ recorder_data::init_record() {
 
 bool
 recorder_data::check_space_limit() {
-    const auto& path = sd->record_options.path;
-    if (path.empty())
-        return true;
-    int64_t space = -1;
-    try {
-        space = fs::space(path).available;
-    } catch (const std::exception&) {
+    // space is cached by storage monitor of streamer
+    if (!storage) {
+        const auto& dir =
+            record_directory(sd->record_options.path, sd->iargs.name);
         std::error_code e;
-        if (!fs::exists(path, e)) {
-            fs::create_directories(path, e);
-            space = fs::space(path, e).available;
-        }
+        if (!fs::exists(dir, e))
+            fs::create_directories(dir, e);
+        storage =
+            sd->super.storage.watch(sd->iargs.name, dir, sd->record_options);
     }
-    if (space < MB) {
+    if (storage->available.load(std::memory_order_relaxed) < MB) {
         logError("recorder: low space for recording src: %s ", sd->iargs.name);
         return false;
     }
@@ -101,11 +98,7 @@ recorder_data::setup_path() {
         rec_path  = rp;
         file_name = fs::path{rp}.filename().string();
     } else {
-        auto dir = rp;
-        if (!fs::is_directory(rp))
-            dir = (fs::path{current_app_path()}.parent_path() /
-                   std::string{"records"} / sd->iargs.name)
-                      .string();
+        auto dir  = record_directory(rp, sd->iargs.name);
         file_name = format_string(
             "%s-%s.%s",
             sd->iargs.name,
@@ -130,6 +123,8 @@ recorder_data::setup_path() {
 
 void
 recorder_data::close() {
+    index.close(last_packet_time);
+    last_packet_time = -1;
     if (!output)
         return;
     if (output->pb && !(output->oformat->flags & AVFMT_NOFILE)) {
@@ -170,19 +165,27 @@ recorder_data::try_setup_output() {
         }
     }
 
-    auto& conf       = sd->record_encoding;
-    conf.audio.codec = codec_t::unknown;
-    if (sd->record_options.record_audio &&
-        fs::path{rec_path}.extension() == "ts")
-        if (auto codec = alternate_proper_audio_codec();
-            codec != codec_t::unknown)
-            conf.audio.codec = codec;
-
+    // source reads encoding ids of writers while planning its encodings
+    encoder_config conf;
+    {
+        std::scoped_lock lock{sd->mutex};
+        auto&            enc = sd->record_encoding;
+        enc.audio.codec      = codec_t::unknown;
+        if (sd->record_options.record_audio &&
+            fs::path{rec_path}.extension() == "ts")
+            if (auto codec = alternate_proper_audio_codec();
+                codec != codec_t::unknown)
+                enc.audio.codec = codec;
+
+        enc.video_id = sd->iencoder.intern(enc.video);
+        enc.audio_id = sd->iencoder.intern(enc.audio);
+        conf         = enc;
+    }
     if (is_valid(conf.video))
-        if (sd->iencoder.initialize(conf.video, octx) != 0)
+        if (sd->iencoder.initialize(conf.video_id, octx) != 0)
             return false;
     if (is_valid(conf.audio))
-        if (sd->iencoder.initialize(conf.audio, octx) != 0)
+        if (sd->iencoder.initialize(conf.audio_id, octx) != 0)
             return false;
 
     if (!make_output_streams())
@@ -254,4 +257,34 @@ recorder_data::finalize() {
         av_write_trailer(output.get());
 }
 
+int
+recorder_data::write_indexed(const AVPacket* pkt) {
+    const auto& cs = sd->demux_data.clock_stream();
+    // packets without source timestamps can not be placed on wall clock
+    if (pkt->stream_index != cs.stream_idx || !cs.stream ||
+        (pkt->pts == AV_NOPTS_VALUE && pkt->dts == AV_NOPTS_VALUE))
+        return write_packet(pkt);
+
+    // interleaving may hold packets, but key frame data is written after
+    int64_t offset = output->pb ? avio_tell(output->pb) : -1;
+    auto    ret    = write_packet(pkt);
+    if (ret < 0)
+        return ret;
+
+    auto time_base = cs.stream->time_base;
+    if (cs.stream_idx == sd->demux_data.audio_stream.stream_idx &&
+        is_valid(sd->record_encoding.audio))
+        time_base = pkt->time_base;
+    auto pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+    last_packet_time =
+        sd->demux_data.clock.to_wall(av_rescale_q(pts, time_base, {1, 1000}));
+
+    if (!(pkt->flags & AV_PKT_FLAG_KEY) || offset < 0)
+        return ret;
+    if (!index.is_open())
+        index.open(rec_path, sd->iargs.name, last_packet_time);
+    index.add(last_packet_time, offset);
+    return ret;
+}
+
 } // namespace lxstreamer
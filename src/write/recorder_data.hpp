@@ -9,6 +9,8 @@
 #ifndef RECORDER_DATA_HPP
 #define RECORDER_DATA_HPP
 
+#include "record_index.hpp"
+#include "storage_monitor.hpp"
 #include "writer_base.hpp"
 
 namespace lxstreamer {
@@ -25,7 +27,11 @@ struct recorder_data : public writer_base {
     uint64_t              written_bytes{0};
     uint64_t              written_duration{0};
     int64_t               first_packet_time{-1};
+    int64_t               last_packet_time{-1}; // ms since epoch
     bool                  initialized{false};
+    record_index          index;
+
+    std::shared_ptr<const storage_state> storage;
 
     recorder_data();
 
@@ -38,6 +44,7 @@ struct recorder_data : public writer_base {
     bool try_setup_output();
     bool setup_output();
     void finalize();
+    int  write_indexed(const AVPacket* pkt);
 };
 
 } // namespace lxstreamer
@@ -0,0 +1,185 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#include "storage_monitor.hpp"
+#include "record_index.hpp"
+#include "utils.hpp"
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace lxstreamer {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const int64_t Mega_Byte          = 1024 * 1024;
+constexpr const int64_t Hour               = 3600 * 1000; // ms
+constexpr const size_t  Remove_Batch_Max   = 64;
+constexpr const auto    Update_Interval    = std::chrono::seconds{2};
+constexpr const int64_t Retention_Interval = 60; // seconds
+
+int64_t
+available_space(const std::string& dir) {
+    std::error_code ec;
+    auto            info = fs::space(dir, ec);
+    return ec ? -1 : static_cast<int64_t>(info.available);
+}
+
+// free space which recycling keeps for the next recorded files
+int64_t
+recycle_reserve(const record_options_t& o) {
+    return std::max<int64_t>(2 * o.file_size * Mega_Byte, 512 * Mega_Byte);
+}
+
+} // namespace
+
+struct storage_monitor::impl {
+    struct watch_t {
+        std::string      dir;
+        record_options_t options;
+    };
+    struct retention_t {
+        elapsed_timer time;
+        bool          pending{true}; // should run on next round
+    };
+
+    using state_ptr = std::shared_ptr<storage_state>;
+
+    std::mutex                                   mutex;
+    std::condition_variable                      cv;
+    bool                                         running{false};
+    std::thread                                  worker;
+    std::unordered_map<std::string, watch_t>     sources;
+    std::unordered_map<std::string, state_ptr>   dirs;
+    std::unordered_map<std::string, retention_t> retentions; // worker only
+
+    ~impl() {
+        {
+            std::scoped_lock lock{mutex};
+            running = false;
+        }
+        cv.notify_all();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock{mutex};
+        while (running) {
+            cv.wait_for(lock, Update_Interval, [&] { return !running; });
+            if (!running)
+                break;
+            auto watches = sources;
+            auto states  = dirs;
+            lock.unlock();
+
+            for (auto& [dir, state] : states)
+                state->available = available_space(dir);
+            for (const auto& [name, w] : watches)
+                apply_retention(name, w, *states[w.dir]);
+
+            lock.lock();
+        }
+    }
+
+    // removes oldest files of source <name> which are out of its retention
+    void apply_retention(
+        const std::string& name, const watch_t& w, storage_state& s) {
+        const auto& o         = w.options;
+        auto        available = s.available.load();
+        auto        reserve   = recycle_reserve(o);
+        auto        is_full   = [&] {
+            return o.recycle && available >= 0 && available < reserve;
+        };
+        auto& r = retentions[name];
+        if (!is_full() && !r.pending && r.time.seconds() < Retention_Interval)
+            return;
+        if (o.max_age == 0 && o.max_size == 0 && !o.recycle)
+            return;
+        r.time.start();
+        r.pending = false;
+
+        auto segments =
+            find_record_segments(w.dir, name, INT64_MIN, INT64_MAX);
+        if (segments.size() < 2)
+            return;
+        std::vector<int64_t> sizes;
+        int64_t              total = 0;
+        for (const auto& seg : segments) {
+            std::error_code ec;
+            auto            size = fs::file_size(seg.path, ec);
+            sizes.push_back(ec ? 0 : static_cast<int64_t>(size));
+            total += sizes.back();
+        }
+        // newest file may be being recorded
+        segments.pop_back();
+
+        const auto               now = system_time_ms();
+        std::vector<std::string> removed;
+        size_t                   i = 0;
+        for (const auto& seg : segments) {
+            bool is_old =
+                o.max_age > 0 &&
+                seg.end_time < now - static_cast<int64_t>(o.max_age) * Hour;
+            bool is_big = o.max_size > 0 &&
+                          total > static_cast<int64_t>(o.max_size) * Mega_Byte;
+            if (!is_old && !is_big && !is_full())
+                break;
+            if (removed.size() == Remove_Batch_Max) {
+                r.pending = true; // continue on next round
+                break;
+            }
+            total -= sizes[i];
+            available += sizes[i];
+            removed.push_back(seg.path);
+            ++i;
+        }
+        if (removed.empty())
+            return;
+
+        for (const auto& path : removed)
+            remove_record_file(path);
+        compact_catalog(w.dir, name);
+        s.available = available_space(w.dir);
+        logInfo(
+            "recorder: removed %d recorded files by retention: src: %s",
+            static_cast<int>(removed.size()),
+            name);
+    }
+};
+
+storage_monitor::storage_monitor() : pimpl{std::make_unique<impl>()} {}
+
+storage_monitor::~storage_monitor() {}
+
+std::shared_ptr<const storage_state>
+storage_monitor::watch(
+    const std::string&      name,
+    const std::string&      dir,
+    const record_options_t& options) {
+    std::scoped_lock lock{pimpl->mutex};
+    pimpl->sources[name] = {dir, options};
+    auto& state          = pimpl->dirs[dir];
+    if (!state) {
+        state            = std::make_shared<storage_state>();
+        state->available = available_space(dir);
+    }
+    if (!pimpl->running) {
+        pimpl->running = true;
+        pimpl->worker  = std::thread{[this] { pimpl->run(); }};
+    }
+    return state;
+}
+
+} // namespace lxstreamer
@@ -0,0 +1,48 @@
+/****************************************************************************
+** Copyright (C) 2022-present Nejat Afshar <nejatafshar@gmail.com>
+** Distributed under the MIT License (http://opensource.org/licenses/MIT)
+**
+** This file is part of lxstreamer.
+** Light-weight http/s streamer.
+****************************************************************************/
+
+#ifndef STORAGE_MONITOR_HPP
+#define STORAGE_MONITOR_HPP
+
+#include "common_types.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace lxstreamer {
+
+/// cached state of a record directory disk, updated by storage_monitor
+struct storage_state {
+    std::atomic<int64_t> available{-1}; ///< free bytes, -1 if unknown
+};
+
+/// watches record directories on a single background thread. keeps their
+/// available space cached for recorders and enforces retention options of
+/// sources by deleting their oldest recorded files in batches
+class storage_monitor
+{
+public:
+    explicit storage_monitor();
+    ~storage_monitor();
+
+    /// registers records <dir> of source <name> with retention <options>,
+    /// returns cached state of its disk which is filled before return
+    std::shared_ptr<const storage_state> watch(
+        const std::string&      name,
+        const std::string&      dir,
+        const record_options_t& options);
+
+protected:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+} // namespace lxstreamer
+
+#endif // STORAGE_MONITOR_HPP
@@ -8,11 +8,10 @@
 
 #include "viewer.hpp"
 #include "ffmpeg_types.hpp"
+#include "packet_queue.hpp"
 #include "viewer_data.hpp"
 
 #include <atomic>
-#include <mutex>
-#include <queue>
 #include <system_error>
 #include <thread>
 
@@ -21,11 +20,10 @@ namespace lxstreamer {
 constexpr const int max_pkt_count = 256;
 
 struct viewer::impl : public viewer_data {
-    std::queue<packet_ref, std::list<packet_ref>> queue;
-    std::atomic_bool                              running{false};
-    std::thread                                   worker;
-    std::mutex                                    mutex;
-    std::condition_variable                       cv;
+    packet_queue     queue{max_pkt_count};
+    std::atomic_bool running{false};
+    std::thread      worker;
+    bool             overflowed{false}; // accessed by producer only
 
 public:
     explicit impl(const uri_data_t& ud, mg_connection* mc)
@@ -33,7 +31,7 @@ public:
 
     ~impl() {
         running = false;
-        cv.notify_all();
+        queue.stop();
         if (worker.joinable()) {
             try {
                 worker.join();
@@ -50,26 +48,28 @@ public:
 
     void start_worker() {
         worker = std::thread{[this]() {
+            sd->pin_thread();
             if (setup_output()) {
                 while (running.load()) {
-                    std::unique_lock<std::mutex> lock(mutex);
-                    cv.wait(lock, [&] {
-                        return !running.load() || !queue.empty();
-                    });
-                    while (!queue.empty()) {
-                        const auto pkt = queue.front().get();
-                        if (write_packet(pkt) < 0) {
-                            running = false;
-                            break;
-                        }
-                        queue.pop();
-                    }
+                    // producer never waits for this thread, even while
+                    // it's blocked in writing to socket
+                    queue.wait();
+                    if (!queue.drain([this](const AVPacket* pkt) {
+                            return write_packet(pkt) >= 0;
+                        }))
+                        running = false;
                 }
                 finalize();
             }
             running = false;
         }};
     }
+
+    // returns if viewer can continue from <pkt> after dropping packets
+    bool is_resume_point(const AVPacket* pkt) const {
+        return (pkt->flags & AV_PKT_FLAG_KEY) &&
+               pkt->stream_index == sd->demux_data.clock_stream().stream_idx;
+    }
 };
 
 viewer::viewer(const uri_data_t& ud, mg_connection* mc)
@@ -87,6 +87,8 @@ viewer::init(source_data* s) {
 
 void
 viewer::start() {
+    if (pimpl->worker.joinable())
+        return; // started already
     pimpl->running = true;
     pimpl->start_worker();
 }
@@ -95,12 +97,21 @@ int
 viewer::write_packet(const AVPacket* pkt) {
     if (!pimpl->running.load(std::memory_order_relaxed))
         return AVERROR_EOF;
-    {
-        std::scoped_lock lock{pimpl->mutex};
-        if (pimpl->queue.size() < max_pkt_count)
-            pimpl->queue.emplace(pkt);
+    auto& d = *pimpl;
+    if (d.overflowed) {
+        if (!d.is_resume_point(pkt))
+            return 0;
+        d.overflowed = false;
+    }
+    if (!d.queue.push(pkt)) {
+        // viewer is slower than source, drop packets up to next key frame
+        // rather than waiting for it
+        d.overflowed = true;
+        logWarn(
+            "viewer: dropped packets of slow viewer: src: %s viewer: %s",
+            d.sd->iargs.name,
+            d.address);
     }
-    pimpl->cv.notify_all();
     return 0;
 }
 
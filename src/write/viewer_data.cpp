@@ -170,18 +170,26 @@ viewer_data::try_setup_output() {
 
     octx->pb = io.get();
 
-    auto& conf       = sd->view_encoding;
-    conf.audio.codec = codec_t::unknown;
-    if (sd->container != container_t::matroska)
-        if (auto codec = alternate_proper_audio_codec();
-            codec != codec_t::unknown)
-            conf.audio.codec = codec;
-
+    // source reads encoding ids of writers while planning its encodings
+    encoder_config conf;
+    {
+        std::scoped_lock lock{sd->mutex};
+        auto&            enc = sd->view_encoding;
+        enc.audio.codec      = codec_t::unknown;
+        if (sd->container != container_t::matroska)
+            if (auto codec = alternate_proper_audio_codec();
+                codec != codec_t::unknown)
+                enc.audio.codec = codec;
+
+        enc.video_id = sd->iencoder.intern(enc.video);
+        enc.audio_id = sd->iencoder.intern(enc.audio);
+        conf         = enc;
+    }
     if (is_valid(conf.video))
-        if (sd->iencoder.initialize(conf.video, octx) != 0)
+        if (sd->iencoder.initialize(conf.video_id, octx) != 0)
             return false;
     if (is_valid(conf.audio))
-        if (sd->iencoder.initialize(conf.audio, octx) != 0)
+        if (sd->iencoder.initialize(conf.audio_id, octx) != 0)
             return false;
 
     if (!make_output_streams())
@@ -142,8 +142,8 @@ writer_base::make_output_streams() {
         } else {
             auto context = sd->iencoder.context(
                 !in_codecpar || in_codecpar->codec_type == AVMEDIA_TYPE_VIDEO
-                    ? sd->view_encoding.video
-                    : sd->view_encoding.audio);
+                    ? sd->view_encoding.video_id
+                    : sd->view_encoding.audio_id);
             int ret =
                 avcodec_parameters_from_context(stream->codecpar, context);
             if (ret < 0) {